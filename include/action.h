@@ -6,28 +6,39 @@
 #include <stdint.h>
 #include "machine.h"
 #include "util.h"
+#include "doorbell.hh"
+#include "small_vector.hh"
+#include "object_pool.hh"
 #include <pthread.h>
 #include <time.h>
 
 class Action;
 
+// A record's table and key in a single word, so that keys compare and hash 
+// as one integer. The key takes bits 0-59, which is enough for every 
+// TPCCKeyGen layout, and the table bits 60-63. Ordering is by table, then key.
 class CompositeKey {
  public:
-  uint64_t m_table;
-  uint64_t m_key;
+  union {
+    struct {
+      uint64_t m_key : 60;
+      uint64_t m_table : 4;
+    };
+    uint64_t m_word;
+  };
 
   CompositeKey(uint64_t table, uint64_t key) {
+    assert(table < 16 && key < (1ULL << 60));
     m_table = table;
     m_key = key;
   }
   
   CompositeKey() {
-    m_table = 0;
-    m_key = 0;
+    m_word = 0;
   }
 
   bool operator==(const CompositeKey &other) const {
-    return other.m_table == this->m_table && other.m_key == this->m_key;
+    return other.m_word == this->m_word;
   }
 
   bool operator!=(const CompositeKey &other) const {
@@ -35,13 +46,11 @@ class CompositeKey {
   }
   
   bool operator<(const CompositeKey &other) const {
-      return ((this->m_table < other.m_table) || 
-              ((this->m_table == other.m_table) && (this->m_key < other.m_key)));
+      return this->m_word < other.m_word;
   }
   
   bool operator>(const CompositeKey &other) const {
-      return ((this->m_table > other.m_table) ||
-              ((this->m_table == other.m_table) && (this->m_key > other.m_key)));
+      return this->m_word > other.m_word;
   }
   
   bool operator<=(const CompositeKey &other) const {
@@ -54,14 +63,31 @@ class CompositeKey {
 };
 
 class EagerAction;
+struct McsLock;
+// A run only uses one lock manager, so the state each of them keeps per 
+// request shares the same space. 
 struct EagerRecordInfo {
     CompositeKey 					record;
     EagerAction						*dependency;
     bool 							is_write;
     bool 							is_held;
-    volatile uint64_t				*latch;
-    struct EagerRecordInfo 			*next;
-    struct EagerRecordInfo			*prev;
+
+    union {
+        // Queue entry for LockManager and DeterministicLockManager.
+        struct {
+            volatile uint64_t				*latch;
+            struct EagerRecordInfo 			*next;
+            struct EagerRecordInfo			*prev;
+        };
+
+        // Queue node for McsLockManager, set up when the lock is requested.
+        // mcs_lock is NULL for requests Continue found another one covers.
+        struct {
+            struct McsLock 					*mcs_lock;
+            struct EagerRecordInfo * volatile	mcs_next;
+            volatile uint64_t 				mcs_state;
+        };
+    };
     
     EagerRecordInfo() {
         record.m_table = 0;
@@ -69,6 +95,7 @@ struct EagerRecordInfo {
         dependency = NULL;
         is_write = false;
         is_held = false;
+        latch = NULL;
         next = NULL;
         prev = NULL;
     }
@@ -98,40 +125,118 @@ struct EagerRecordInfo {
     }    
 };
 
-// The lazy scheduler has an entry of this type for every single record that is
-// read or written in the system.
+// A txn, whether it wrote a record and its index in that txn's read or write
+// set, packed into a single word. Bits 0-46 hold the txn pointer (user space 
+// addresses fit in 47 bits), bit 47 the write flag and bits 48-63 the signed
+// index. Used for the scheduler's per-record entries and for the edges of 
+// the dependency graph. 
+class PackedDep {
+ public:
+    static const uint64_t PTR_MASK = (1ULL << 47) - 1;
+    static const uint64_t WRITE_BIT = 1ULL << 47;
+    static const int INDEX_SHIFT = 48;
+    static const uint64_t EMPTY = ((uint64_t)0xFFFF) << INDEX_SHIFT;
+
+    static inline uint64_t
+    Pack(Action *txn, int index, bool is_write) {
+        assert(((uint64_t)txn & ~PTR_MASK) == 0);
+        assert(index >= -1 && index < (1 << 15));
+        return ((uint64_t)txn | 
+                ((uint64_t)is_write << 47) | 
+                ((uint64_t)(uint16_t)(int16_t)index << INDEX_SHIFT));
+    }
+
+    static inline Action*
+    Txn(uint64_t dep) {
+        return (Action*)(dep & PTR_MASK);
+    }
+
+    static inline int
+    Index(uint64_t dep) {
+        return (int)(int16_t)(dep >> INDEX_SHIFT);
+    }
+
+    static inline bool
+    IsWrite(uint64_t dep) {
+        return (dep & WRITE_BIT) != 0;
+    }
+};
+
+// An entry in a lazy txn's read or write set: the record, and the edge to 
+// the txn that touched it last, 16 bytes in all. The edge is cut by 
+// clearing its pointer bits, which leaves the flag and index alone, so a 
+// walk that loaded the pointer before the cut still finds its way.
 struct DependencyInfo {
-    Action *dependency;
+    uint64_t m_dep;
     CompositeKey record;
-    bool is_write;
-    bool is_held;
-    int index;
+
+    DependencyInfo() {
+        m_dep = PackedDep::EMPTY;
+    }
+
+    inline Action*
+    Dependency() const {
+        return PackedDep::Txn(m_dep);
+    }
+
+    inline bool
+    IsWrite() const {
+        return PackedDep::IsWrite(m_dep);
+    }
+
+    inline int
+    Index() const {
+        return PackedDep::Index(m_dep);
+    }
+
+    inline void
+    SetDependency(Action *txn, int index, bool is_write) {
+        m_dep = PackedDep::Pack(txn, index, is_write);
+    }
+
+    // Clear the edge if it still points to prev. 
+    inline bool
+    Cut(Action *prev) {
+        uint64_t dep = m_dep;
+        if (PackedDep::Txn(dep) != prev) {
+            return false;
+        }
+        return cmp_and_swap((volatile uint64_t*)&m_dep, dep, 
+                            dep & ~PackedDep::PTR_MASK);
+    }
 
     bool operator<(const struct DependencyInfo &other) const {
-        return (((uint64_t)this->dependency) > ((uint64_t)other.dependency));
+        return (((uint64_t)this->Dependency()) > ((uint64_t)other.Dependency()));
     }
     
     bool operator>(const struct DependencyInfo &other) const {
-        return (((uint64_t)this->dependency) < ((uint64_t)other.dependency));
+        return (((uint64_t)this->Dependency()) < ((uint64_t)other.Dependency()));
     }
     
     bool operator==(const struct DependencyInfo &other) const {
-        return (((uint64_t)this->dependency) == ((uint64_t)other.dependency));
+        return (((uint64_t)this->Dependency()) == ((uint64_t)other.Dependency()));
     }
     
     bool operator!=(const struct DependencyInfo &other) const {
-        return (((uint64_t)this->dependency) != ((uint64_t)other.dependency));
+        return (((uint64_t)this->Dependency()) != ((uint64_t)other.Dependency()));
     }
 
     bool operator>=(const struct DependencyInfo &other) const {
-        return (((uint64_t)this->dependency) <= ((uint64_t)other.dependency));
+        return (((uint64_t)this->Dependency()) <= ((uint64_t)other.Dependency()));
     }
 
     bool operator<=(const struct DependencyInfo &other) const {
-        return (((uint64_t)this->dependency) >= ((uint64_t)other.dependency));
+        return (((uint64_t)this->Dependency()) >= ((uint64_t)other.Dependency()));
     }        
 };
 
+// Number of read or write set entries a txn keeps inline. Bigger sets go to
+// the Arena.
+#define INLINE_SET_SIZE 4
+
+typedef SmallVector<struct DependencyInfo, INLINE_SET_SIZE> DependencySet;
+typedef SmallVector<struct EagerRecordInfo, INLINE_SET_SIZE> EagerRecordSet;
+
 class Action {
 
  public:  
@@ -147,15 +252,53 @@ class Action {
   //  volatile uint64_t end_time;
   //  volatile uint64_t system_start_time;
   //  volatile uint64_t system_end_time;
-  std::vector<struct DependencyInfo> readset;
-  std::vector<struct DependencyInfo> writeset;
+  DependencySet readset;
+  DependencySet writeset;
 
   //  std::vector<int> real_writes;
   //  volatile uint64_t __attribute__((aligned(CACHE_LINE))) sched_start_time;    
   //  volatile uint64_t __attribute__((aligned(CACHE_LINE))) sched_end_time;    
   //  volatile uint64_t __attribute__((aligned(CACHE_LINE))) lock_word;
 
+  // Scheduler bookkeeping. sched_seq is the action's position in the global
+  // serial order. When the scheduler is partitioned, sched_pending counts the
+  // partitions that have not yet added the action to the dependency graph,
+  // and sched_force is set by any partition that wants it substantiated.
+  // Workers leave the action alone until sched_pending is 0, its 
+  // dependencies may be half written before then.
+  uint64_t sched_seq;
+  volatile uint64_t sched_pending;
+  volatile uint64_t sched_force;
+
   volatile uint64_t __attribute__((aligned(CACHE_LINE))) state;
+
+  // References to this action: one held by whoever submitted it until its 
+  // output is consumed, plus one for every Heuristic entry and every 
+  // DependencyInfo that points to it. The action is retired to the 
+  // EpochManager when the count drops to zero.
+  volatile uint64_t refcount;
+
+  // Stack of workers' wait list nodes for txns that couldn't claim this 
+  // action. Whoever takes it out of PROCESSING hands them back to their 
+  // workers. 
+  volatile uint64_t waiters;
+
+  // Pool the action goes back to once it's retired, NULL if it came from new.
+  PoolBase *pool;
+
+  Action() {
+    materialize = false;
+    is_blind = false;
+    sched_seq = 0;
+    sched_pending = 0;
+    sched_force = 0;
+    state = 0;
+    refcount = 1;
+    waiters = 0;
+    pool = NULL;
+  }
+
+  virtual ~Action() { }
   
   virtual bool NowPhase() { return true; }
   virtual void LaterPhase() { }
@@ -177,8 +320,8 @@ ReplicateRecords(Action *action) {
 class EagerAction {
  public:
     volatile uint64_t __attribute__((aligned(CACHE_LINE))) num_dependencies;
-    std::vector<struct EagerRecordInfo> writeset;
-    std::vector<struct EagerRecordInfo> readset;
+    EagerRecordSet writeset;
+    EagerRecordSet readset;
 
     timespec start_time;
     timespec end_time;
@@ -194,6 +337,36 @@ class EagerAction {
     EagerAction 			*next;
     EagerAction 	*prev;
     bool 			finished_execution;
+
+    // Stack of the worker running this txn. The lock manager pushes the txn 
+    // on it, through next, once the txn has been granted all its locks.
+    volatile uint64_t 		*ready;
+    Doorbell 				*bell;		// Rung after the push, if set
+
+    // Position in the merged read/write sets of the next lock to request, for
+    // lock managers that request them one at a time.
+    uint32_t 				lock_read_index;
+    uint32_t 				lock_write_index;
+
+    // Order in which the txn requested its locks, for lock managers that
+    // keep one.
+    uint64_t 				lock_seq;
+
+    // Set once a multi-partition txn has run, for the partitioned engine.
+    volatile uint64_t 		partition_released;
+
+    EagerAction() {
+        num_dependencies = 0;
+        next = NULL;
+        prev = NULL;
+        finished_execution = false;
+        ready = NULL;
+        bell = NULL;
+        lock_read_index = 0;
+        lock_write_index = 0;
+        lock_seq = 0;
+        partition_released = 0;
+    }
 };
 
 
@@ -0,0 +1,82 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		ARENA_HH_
+#define 		ARENA_HH_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <machine.h>
+
+// Smallest and largest blocks the arena hands out, as powers of two. Larger
+// requests go straight to malloc.
+#define 	ARENA_MIN_SHIFT 	6
+#define 	ARENA_MAX_SHIFT 	16
+#define 	ARENA_CHUNK 		(1<<20)
+
+// Chunks are aligned to their size, and the first ARENA_HEADER bytes of each 
+// hold a pointer to the owning thread's state.
+#define 	ARENA_HEADER 		(1<<ARENA_MIN_SHIFT)
+
+// Per-thread allocator for variable sized buffers that come and go quickly,
+// such as the overflow storage of txns' read and write sets. Sizes are
+// rounded up to a power of two. Blocks are carved out of large chunks and
+// recycled through a free list per size, so a thread that keeps creating
+// and freeing txns stops calling malloc once its lists are warm.
+//
+// A block may be freed by a thread other than the one that allocated it, in
+// which case it goes back to the allocating thread, which finds it at the 
+// start of the block's chunk. The owner takes returned blocks back a size 
+// at a time once its own list runs dry. Chunks are never returned to the 
+// system.
+class Arena {
+private:
+    struct FreeBlock {
+        FreeBlock 						*next;
+    };
+
+    struct ThreadState {
+        FreeBlock 						*free_lists[ARENA_MAX_SHIFT+1];
+        char 							*cursor;
+        char 							*end;
+        uint64_t 						num_chunks;
+
+        // Blocks other threads have freed, pushed with a CAS and taken by 
+        // the owner all at once. 
+        volatile uint64_t __attribute__((aligned(CACHE_LINE))) 
+            returned[ARENA_MAX_SHIFT+1];
+    };
+
+    static __thread ThreadState 		*t_state;
+
+    static ThreadState*
+    State();
+
+    static inline ThreadState*
+    Owner(void *ptr) {
+        return *(ThreadState**)((uintptr_t)ptr & ~(uintptr_t)(ARENA_CHUNK-1));
+    }
+
+    static inline int
+    SizeClass(size_t size) {
+        int shift = ARENA_MIN_SHIFT;
+        while (((size_t)1 << shift) < size) {
+            shift += 1;
+        }
+        return shift;
+    }
+
+public:
+    static void*
+    Alloc(size_t size);
+
+    // Any thread. size must be the size the block was allocated with.
+    static void
+    Free(void *ptr, size_t size);
+
+    // Number of chunks the calling thread has taken from malloc.
+    static uint64_t
+    NumChunks();
+};
+
+#endif 		//  ARENA_HH_
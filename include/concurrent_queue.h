@@ -13,6 +13,7 @@
 
 #include "util.h"
 #include "machine.h"
+#include "doorbell.hh"
 
 
 #define CACHE_PAD 64
@@ -37,19 +38,102 @@ struct queue_elem {
 } __attribute__((aligned(64)));
 
 
+// Single producer, single consumer ring of 8-byte values. Entries are packed
+// densely, eight to a cache line. The producer only writes m_head and the 
+// consumer only writes m_tail, each with a plain store, and both keep a 
+// cached copy of the other side's index so that they only touch the remote 
+// cache line once they run out of room or entries. The batch calls move 
+// several entries for a single index update.
+//
+// values must hold size uint64_ts, and size must be a power of two. 
 class SimpleQueue {
-    char* m_values;
+    // Set up before the queue is shared, read-only afterwards.
+    uint64_t* m_values;
     uint64_t m_size;
-    volatile uint64_t __attribute__((aligned(CACHE_LINE))) m_head;    
-    volatile uint64_t __attribute__((aligned(CACHE_LINE))) m_tail;    
+
+    // Rung when an element is added, and when one is removed. Idle consumers 
+    // and blocked producers sleep on these.
+    Doorbell *m_not_empty;
+    Doorbell *m_not_full;
+
+    // Producer's line: its index, and the last m_tail it saw. 
+    volatile uint64_t __attribute__((aligned(CACHE_LINE))) m_head;
+    uint64_t m_tail_cache;
+
+    // Consumer's line: its index, and the last m_head it saw. 
+    volatile uint64_t __attribute__((aligned(CACHE_LINE))) m_tail;
+    uint64_t m_head_cache;
+
+    // Producer only. Room for at least count more entries? 
+    inline bool
+    HasRoom(uint64_t count) {
+        if (m_head + count > m_tail_cache + m_size) {
+            m_tail_cache = m_tail;
+        }
+        asm volatile("":::"memory");
+        return m_head + count <= m_tail_cache + m_size;
+    }
+
+    // Consumer only. Number of entries available, only looks at m_head if 
+    // fewer than wanted are known to be there.
+    inline uint64_t
+    Available(uint64_t wanted) {
+        if (m_head_cache - m_tail < wanted) {
+            m_head_cache = m_head;
+        }
+        asm volatile("":::"memory");
+        return m_head_cache - m_tail;
+    }
+
+    // Make the entries before head visible to the consumer. 
+    inline void
+    PublishHead(uint64_t head) {
+        asm volatile("":::"memory");
+        m_head = head;
+        Notify(m_not_empty);
+    }
+
+    // Hand the slots before tail back to the producer. 
+    inline void
+    PublishTail(uint64_t tail) {
+        asm volatile("":::"memory");
+        m_tail = tail;
+        Notify(m_not_full);
+    }
+
+    // The indices are published with plain stores, which may pass the load 
+    // of the bell's sleeper count, so a peer that parks at the wrong moment
+    // could miss the update. Fence first, but only if threads park at all.
+    static inline void
+    Notify(Doorbell *bell) {
+        if (bell != NULL && Doorbell::s_spin_limit != 0) {
+            asm volatile("mfence":::"memory");
+            bell->Ring();
+        }
+    }
 
  public:
     SimpleQueue(char* values, uint64_t size) {
-        m_values = values;
+        m_values = (uint64_t*)values;
         m_size = (uint64_t)size;
         assert(!(m_size & (m_size-1)));
         m_head = 0;
         m_tail = 0;        
+        m_tail_cache = 0;
+        m_head_cache = 0;
+        m_not_empty = NULL;
+        m_not_full = NULL;
+    }
+
+    // Set by the consumer, so producers wake it up. 
+    void SetConsumer(Doorbell *not_empty) {
+        m_not_empty = not_empty;
+    }
+
+    // Set by the producer, so the consumer wakes it up if it's blocked in 
+    // EnqueueBlocking.
+    void SetProducer(Doorbell *not_full) {
+        m_not_full = not_full;
     }
     
     uint64_t diff() {
@@ -61,57 +145,99 @@ class SimpleQueue {
         return m_head == m_tail;
     }
 
+    // Number of elements in the queue. Only a snapshot if called by a thread 
+    // other than the producer and consumer.
+    uint64_t Size() {
+        return m_head - m_tail;
+    }
+
     bool Enqueue(uint64_t data) {
-        assert(m_head >= m_tail);
-        if (m_head == m_tail + m_size) {
+        if (!HasRoom(1)) {
             return false;
         }
-        else {
-            uint64_t index = m_head & (m_size-1);
-            assert(index < m_size);
-            
-            (*(uint64_t*)&m_values[index*CACHE_LINE]) = data;
-            fetch_and_increment(&m_head);
-            return true;
+        uint64_t head = m_head;
+        m_values[head & (m_size-1)] = data;
+        PublishHead(head + 1);
+        return true;
+    }
+
+    // Enqueue as many of the count values in data as fit, returns how many 
+    // did. 
+    uint32_t EnqueueBatch(const uint64_t *data, uint32_t count) {
+        HasRoom(count);
+        uint64_t head = m_head;
+        uint64_t room = m_tail_cache + m_size - head;
+        if (room == 0) {
+            return 0;
+        }
+        uint32_t num = room < count? (uint32_t)room : count;
+        for (uint32_t i = 0; i < num; ++i) {
+            m_values[(head + i) & (m_size-1)] = data[i];
         }
+        PublishHead(head + num);
+        return num;
     }
     
     void EnqueueBlocking(uint64_t data) {
-        assert(m_head >= m_tail);
-        while (m_head == m_tail + m_size) 
-            ;
-        uint64_t index = m_head & (m_size - 1);
-        assert(index < m_size);
-        assert(index <= ((m_size - 1) << 6));
-        (*(uint64_t*)&m_values[index*CACHE_LINE]) = data;
-        fetch_and_increment(&m_head);
+        uint64_t spins = 0;
+        while (!HasRoom(1)) {
+            if (m_not_full != NULL && Doorbell::Spin(&spins)) {
+                uint32_t seq = m_not_full->Prepare();
+                if (HasRoom(1)) {
+                    m_not_full->Cancel();
+                }
+                else {
+                    m_not_full->Wait(seq);
+                }
+            }
+        }
+        uint64_t head = m_head;
+        m_values[head & (m_size-1)] = data;
+        PublishHead(head + 1);
     }
     
     uint64_t DequeueBlocking() {
-        assert(m_head >= m_tail);
-        while (m_head == m_tail) 
-            ;
-        uint64_t index = m_tail & (m_size - 1);
-        assert(index < m_size);
-        assert(index <= ((m_size - 1) << 6));
-        uint64_t ret = (*(uint64_t*)&m_values[index*CACHE_LINE]);
-        fetch_and_increment(&m_tail);
+        uint64_t spins = 0;
+        while (Available(1) == 0) {
+            if (m_not_empty != NULL && Doorbell::Spin(&spins)) {
+                uint32_t seq = m_not_empty->Prepare();
+                if (Available(1) != 0) {
+                    m_not_empty->Cancel();
+                }
+                else {
+                    m_not_empty->Wait(seq);
+                }
+            }
+        }
+        uint64_t tail = m_tail;
+        uint64_t ret = m_values[tail & (m_size-1)];
+        PublishTail(tail + 1);
         return ret;
     }
 
     bool Dequeue(uint64_t* value) {
-        assert(m_head >= m_tail);
-        if (m_head == m_tail) {
+        if (Available(1) == 0) {
             return false;
         }
-        else {
-            uint64_t index = m_tail & (m_size - 1);            
-            assert(index < m_size);
-            assert(index <= ((m_size - 1) << 6));
-            *value = (*(uint64_t*)&m_values[index*CACHE_LINE]);
-            fetch_and_increment(&m_tail);
-            return true;
+        uint64_t tail = m_tail;
+        *value = m_values[tail & (m_size-1)];
+        PublishTail(tail + 1);
+        return true;
+    }
+
+    // Dequeue up to max values into data, returns how many there were. 
+    uint32_t DequeueBatch(uint64_t *data, uint32_t max) {
+        uint64_t avail = Available(max);
+        if (avail == 0) {
+            return 0;
+        }
+        uint32_t num = avail < max? (uint32_t)avail : max;
+        uint64_t tail = m_tail;
+        for (uint32_t i = 0; i < num; ++i) {
+            data[i] = m_values[(tail + i) & (m_size-1)];
         }
+        PublishTail(tail + num);
+        return num;
     }
 } __attribute__((aligned(CACHE_LINE)));
 
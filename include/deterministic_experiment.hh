@@ -0,0 +1,43 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		DETERMINISTIC_EXPERIMENT_HH_
+#define 		DETERMINISTIC_EXPERIMENT_HH_
+
+#include <eager_experiment.hh>
+#include <deterministic_lock_manager.hh>
+#include <deterministic_scheduler.hh>
+#include <deterministic_worker.hh>
+
+// Runs the eager engine's workloads through deterministic locking: a single
+// DeterministicScheduler thread grants locks in submission order and
+// DeterministicWorkers run the txns that hold them.
+class DeterministicExperiment : public EagerExperiment {
+private:
+    DeterministicScheduler 		*m_scheduler;
+    DeterministicWorker 		**m_det_workers;
+
+    void
+    RunDeterministic(cc_params::TableInit *params, int num_params);
+
+protected:
+    virtual void
+    StartWorkers();
+
+    virtual void
+    RunTPCC();
+
+    virtual void
+    RunThroughput();
+
+    virtual void
+    RunPeak();
+
+    virtual void
+    RunBlind();
+
+public:
+    DeterministicExperiment(ExperimentInfo *info);
+};
+
+#endif 		//  DETERMINISTIC_EXPERIMENT_HH_
@@ -0,0 +1,62 @@
+// Author: Kun Ren (kun@cs.yale.edu)
+//
+// Lock manager implementing deterministic two-phase locking as described in
+// 'The Case for Determinism in Database Systems'.
+
+#ifndef 		DETERMINISTIC_LOCK_MANAGER_HH_
+#define 		DETERMINISTIC_LOCK_MANAGER_HH_
+
+#include <action.h>
+#include <concurrency_control_params.hh>
+
+// A record's lock requests, oldest first. The record is locked by the first
+// request if it's a write, or by the longest prefix of reads otherwise.
+struct DeterministicQueue {
+    struct EagerRecordInfo 			*head;
+    struct EagerRecordInfo 			*tail;
+
+    DeterministicQueue() {
+        head = NULL;
+        tail = NULL;
+    }
+};
+
+// Only ever used by the one lock-granting thread, which requests all of a
+// txn's locks before it moves on to the next txn. Txns therefore get their
+// locks in the order they were locked, there are no deadlocks, and nothing
+// needs a latch.
+class DeterministicLockManager {
+private:
+    Table<uint64_t, DeterministicQueue>		**m_tables;
+
+    // Txns that got their last lock in Release, linked through next.
+    EagerAction 							*m_ready_head;
+    EagerAction 							*m_ready_tail;
+
+    // Returns true if dep's lock was granted right away.
+    bool
+    Request(EagerAction *txn, struct EagerRecordInfo *dep);
+
+    void
+    Release(struct EagerRecordInfo *dep);
+
+    void
+    Grant(struct EagerRecordInfo *dep);
+
+public:
+    DeterministicLockManager(cc_params::TableInit *params, int num_params);
+
+    // Request all of txn's locks. Returns true if they were all granted,
+    // otherwise txn comes out of NextReady once it holds them.
+    bool
+    Lock(EagerAction *txn);
+
+    void
+    Release(EagerAction *txn);
+
+    // Oldest txn that was granted its last lock by Release, or NULL.
+    EagerAction*
+    NextReady();
+};
+
+#endif 		//  DETERMINISTIC_LOCK_MANAGER_HH_
@@ -0,0 +1,65 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		DETERMINISTIC_SCHEDULER_HH_
+#define 		DETERMINISTIC_SCHEDULER_HH_
+
+#include <deterministic_lock_manager.hh>
+#include <concurrent_queue.h>
+#include <submit_queue.hh>
+#include <runnable.hh>
+#include <doorbell.hh>
+
+// Number of txns the scheduler moves between queues at a time.
+#define DETERMINISTIC_BATCH 	32
+
+// The one thread that grants locks in the deterministic engine. It takes txns
+// in the order the clients submitted them, requests all of a txn's locks
+// before it looks at the next one, and sends txns that hold all their locks to
+// the workers round robin. Workers send txns back once they have run, and the
+// scheduler releases their locks, which can make more txns ready.
+class DeterministicScheduler : public Runnable {
+private:
+    DeterministicLockManager 	*m_lock_mgr;
+    SubmitQueue 				*m_input_queue;
+    SimpleQueue 				**m_worker_queues;
+    SimpleQueue 				**m_done_queues;
+    int 						m_num_workers;
+    int 						m_next_worker;
+
+    // Txns that have been locked but not released yet, at most m_window.
+    // Keeps the worker and done queues from filling up.
+    uint32_t 					m_num_active;
+    uint32_t 					m_window;
+
+    Doorbell 					m_bell;			// Rung for input and done txns
+
+    void
+    Start(EagerAction *txn);
+
+    void
+    Finish(EagerAction *txn);
+
+    void
+    Send(EagerAction *txn);
+
+    bool
+    HasWork();
+
+    void
+    Sleep();
+
+protected:
+    virtual void
+    StartWorking();
+
+public:
+    // window must be at most the size of each worker and done queue.
+    DeterministicScheduler(DeterministicLockManager *lock_mgr,
+                           SubmitQueue *input_queue,
+                           SimpleQueue **worker_queues,
+                           SimpleQueue **done_queues, int num_workers,
+                           uint32_t window, int cpu);
+};
+
+#endif 		//  DETERMINISTIC_SCHEDULER_HH_
@@ -0,0 +1,36 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		DETERMINISTIC_WORKER_HH_
+#define 		DETERMINISTIC_WORKER_HH_
+
+#include <action.h>
+#include <concurrent_queue.h>
+#include <runnable.hh>
+#include <doorbell.hh>
+
+// Runs txns the deterministic scheduler has already granted all their locks,
+// and hands them back to it to release them.
+class DeterministicWorker : public Runnable {
+private:
+    SimpleQueue 			*m_input_queue;			// Txns holding their locks
+    SimpleQueue 			*m_done_queue;			// Back to the scheduler
+    SimpleQueue 			*m_output_queue;		// Finished txns
+    volatile uint32_t 		m_num_done;
+    Doorbell 				m_bell;					// Rung for input
+
+protected:
+    virtual void
+    StartWorking();
+
+public:
+    DeterministicWorker(SimpleQueue *input_queue, SimpleQueue *done_queue,
+                        SimpleQueue *output_queue, int cpu);
+
+    uint32_t
+    NumProcessed() {
+        return m_num_done;
+    }
+};
+
+#endif 		//  DETERMINISTIC_WORKER_HH_
@@ -0,0 +1,94 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		DOORBELL_HH_
+#define 		DOORBELL_HH_
+
+#include <cassert>
+#include <climits>
+#include <stdint.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <machine.h>
+#include <util.h>
+
+// Lets an idle thread sleep on a futex until a producer has something for it.
+// Producers call Ring after publishing work, which is a single load unless
+// somebody is asleep. A consumer that found nothing to do goes through
+// Prepare, checks for work once more, and then either Waits or Cancels:
+//
+// 		uint32_t seq = bell->Prepare();
+// 		if (HasWork())
+//			bell->Cancel();
+//		else
+// 			bell->Wait(seq);
+//
+// A Ring that comes after Prepare makes Wait return right away, and a Ring
+// that comes before it has its work seen by the second check, so no wakeup
+// is ever lost.
+class Doorbell {
+private:
+    volatile uint32_t __attribute__((aligned(CACHE_LINE)))	m_seq;
+    volatile uint64_t 										m_sleepers;
+    volatile uint64_t 										m_num_parks;
+
+public:
+    // Number of empty polls before a thread parks. 0 means always spin.
+    static uint64_t 										s_spin_limit;
+
+    Doorbell() {
+        m_seq = 0;
+        m_sleepers = 0;
+        m_num_parks = 0;
+    }
+
+    // Count an empty poll. Returns true once the caller has spun long enough
+    // and should try to park.
+    static inline bool
+    Spin(uint64_t *spins) {
+        if (s_spin_limit == 0) {
+            return false;
+        }
+        if (++(*spins) < s_spin_limit) {
+            do_pause();
+            return false;
+        }
+        *spins = 0;
+        return true;
+    }
+
+    inline void
+    Ring() {
+        if (m_sleepers != 0) {
+            __sync_fetch_and_add(&m_seq, 1);
+            syscall(SYS_futex, &m_seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL,
+                    NULL, 0);
+        }
+    }
+
+    inline uint32_t
+    Prepare() {
+        fetch_and_increment(&m_sleepers);
+        return m_seq;
+    }
+
+    inline void
+    Cancel() {
+        fetch_and_decrement(&m_sleepers);
+    }
+
+    inline void
+    Wait(uint32_t seq) {
+        m_num_parks += 1;
+        syscall(SYS_futex, &m_seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+        fetch_and_decrement(&m_sleepers);
+    }
+
+    uint64_t
+    NumParks() {
+        return m_num_parks;
+    }
+};
+
+#endif 		//  DOORBELL_HH_
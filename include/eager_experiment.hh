@@ -5,6 +5,8 @@
 #include <eager_tpcc_generator.hh>
 #include <eager_worker.hh>
 #include <lock_manager.hh>
+#include <mcs_lock_manager.hh>
+#include <vll_lock_manager.hh>
 #include <concurrency_control_params.hh>
 #include <cpuinfo.h>
 #include <tpcc_table_spec.hh>
@@ -18,41 +20,83 @@
 #include <fstream>
 #include <shopping_cart.h>
 
+// A thread that generates its share of a run's txns and submits them to the
+// workers through its own ring of each worker's SubmitQueue, in a run with 
+// more than one client. 
+struct EagerClient {
+    EagerGenerator 			*gen;
+    SubmitQueue 			**queues;
+    int 					num_queues;
+    EagerAction 			**actions;		// Where to record the txns
+    int 					num_inputs;
+    int 					id;				// Takes every num_clients'th txn
+    int 					num_clients;
+    Doorbell 				bell;			// Rung as the workers drain
+    int 					cpu;
+    pthread_t 				thread;
+};
+
 class EagerExperiment : public Experiment {
-private:
-    LockManager			*m_lock_mgr;
+protected:
+    EagerLockManager	*m_lock_mgr;
     EagerWorker			**m_workers;
     EagerAction 		**m_actions;
+    Doorbell 			m_bell;			// Rung by the output queues
+    const char 			*m_engine;		// Names the TPCC CDF files
+    EagerClient 		*m_clients;		// NULL with a single client
+
 
+    EagerLockManager*
+    NewLockManager(cc_params::TableInit *params, int num_params);
+
+    cc_params::TableInit*
+    InitializeTPCCParams();
 
     void
     InitializeTPCCLockManager();
 
+    EagerGenerator*
+    NewGenerator();
+
     void
-    InitInputs(SimpleQueue **input_queues, int num_inputs, int num_workers, 
+    InitInputs(SubmitQueue **input_queues, int num_inputs, int num_workers, 
                EagerGenerator *gen);
 
+    void
+    StartClients(SubmitQueue **input_queues, int num_inputs, int num_workers,
+                 EagerGenerator *gen);
+
+    void
+    JoinClients();
+
+    static void*
+    RunClient(void *arg);
+
     EagerWorker**
-    InitWorkers(int num_workers, SimpleQueue **input_queues, 
+    InitWorkers(int num_workers, SubmitQueue **input_queues, 
                 SimpleQueue **output_queues, int cpu_offset);
 
-    void
-    DoThroughputExperiment(EagerWorker **workers, SimpleQueue **output_queues, 
-                           int num_workers, uint32_t num_waits);
+    // Starts the threads that run the txns in DoThroughputExperiment.
+    virtual void
+    StartWorkers();
 
     void
+    DoThroughputExperiment(SimpleQueue **output_queues, int num_workers, 
+                           uint32_t num_waits);
+
+    virtual void
     RunTPCC();
 
     void
     WriteBlindLatencies();
 
-    void
+    virtual void
     RunThroughput();
 
-    void
+    virtual void
     RunPeak();
 
-    void
+    virtual void
     RunBlind();
     
     void
@@ -63,6 +107,9 @@ private:
     
     void
     WriteLatencies();
+
+    void
+    WriteTPCCLatencies();
     
     void
     WaitPeak(uint32_t duration,
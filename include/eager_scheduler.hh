@@ -3,12 +3,13 @@
 
 #include <lock_manager.hh>
 #include <concurrent_queue.h>
+#include <submit_queue.hh>
 
 class EagerScheduler : public Runnable {
 private:
-    LockManager 		*m_lock_manager;
+    EagerLockManager 	*m_lock_manager;
     SimpleQueue 		*m_input_queue;
-    SimpleQueue			**m_worker_input_queues;
+    SubmitQueue			**m_worker_input_queues;
     uint32_t 			m_num_workers;
 
 protected:
@@ -19,14 +20,15 @@ protected:
         uint64_t index = 0;
         while (true) {
             txn = (EagerAction*)m_input_queue->DequeueBlocking();            
-            while (!m_worker_input_queues[index%m_num_workers]->Enqueue((uint64_t)txn)) {
+            while (!m_worker_input_queues[index%m_num_workers]->Producer(0)->
+                   Enqueue((uint64_t)txn)) {
                 index += 1;
             }
         }
     }
 
 public:
-    EagerScheduler(LockManager *mgr, SimpleQueue *input, SimpleQueue **workers, 
+    EagerScheduler(EagerLockManager *mgr, SimpleQueue *input, SubmitQueue **workers, 
                    uint32_t num_workers, int cpu_number)
         : Runnable(cpu_number) {
         m_lock_manager = mgr;
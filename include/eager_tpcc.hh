@@ -242,7 +242,7 @@ private:
     DeliveryEager2			*m_level2_txn;
 
     int
-    GetIndex(const std::vector<struct EagerRecordInfo> &info, uint32_t size, 
+    GetIndex(const EagerRecordSet &info, uint32_t size, 
              const struct EagerRecordInfo &cmp);
 
 public:
@@ -6,31 +6,28 @@
 
 #include <lock_manager.hh>
 #include <concurrent_queue.h>
+#include <submit_queue.hh>
 #include <pthread.h>
 #include <cpuinfo.h>
 #include <runnable.hh>
 
 class EagerWorker : public Runnable {
 private:
-    LockManager				*m_lock_mgr;			// Global lock manager
-    SimpleQueue 			*m_txn_input_queue;		// Thread-local input queue
+    EagerLockManager		*m_lock_mgr;			// Global lock manager
+    SubmitQueue 			*m_txn_input_queue;		// Txns from the clients
     SimpleQueue 			*m_output_queue;		// Thread-local output queue
     int 					m_cpu_number;			// CPU to which to bind
-    EagerAction 			*m_queue_head;			// Head of queue of waiting txns
-    EagerAction				*m_queue_tail;			// Tail of queue of waiting txns
-    int						m_num_elems;			// Number of elements in the queue
+    int						m_num_elems;			// Number of txns waiting on locks
     volatile uint32_t 		m_num_done;
+
+    // Txns that have been granted all their locks, pushed by the lock manager.
+    volatile uint64_t __attribute__((aligned(CACHE_LINE))) m_ready;
+    Doorbell 				m_bell;			// Rung for input and m_ready
     
     // Worker thread function
     virtual void
     WorkerFunction();
 
-    void
-    Enqueue(EagerAction *txn);
-
-    void
-    RemoveQueue(EagerAction *txn);
-
     void
     CheckReady();
 
@@ -39,16 +36,19 @@ private:
 
     void
     DoExec(EagerAction *txn);
-    
-    uint32_t
-    QueueCount(EagerAction *txn);
+
+    bool
+    HasWork();
+
+    void
+    Sleep();
 
 protected:    
     virtual void
     StartWorking();
 
 public:
-    EagerWorker(LockManager *mgr, SimpleQueue *input_queue, 
+    EagerWorker(EagerLockManager *mgr, SubmitQueue *input_queue, 
                 SimpleQueue *output_queue, int cpu);
     
     uint32_t 
@@ -0,0 +1,80 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+// 
+
+#ifndef 		EPOCH_MANAGER_HH_
+#define 		EPOCH_MANAGER_HH_
+
+#include <action.h>
+#include <util.h>
+#include <machine.h>
+#include <vector>
+
+#define 	MAX_EPOCH_THREADS 	256
+
+// Epoch-based reclamation of Actions. Every thread that dereferences actions
+// it holds no reference on (scheduler, partitions, workers and the client) 
+// registers once, and brackets its work with Enter() and Exit(). An action 
+// retired in epoch e is freed once the global epoch reaches e+2, at which 
+// point no thread can still be in a critical section that saw it. 
+class EpochManager {
+private:
+    struct ThreadState {
+        volatile uint64_t 		epoch;
+        volatile uint64_t 		active;
+        uint64_t 				num_enters;
+        std::vector<Action*> 	limbo[3];		// Retired, by epoch mod 3
+    } __attribute__((aligned(CACHE_LINE)));
+
+    static volatile uint64_t 	s_global_epoch;
+    static volatile uint64_t 	s_num_threads;
+    static ThreadState 			*s_threads;
+    static __thread ThreadState *t_state;
+    
+    static void
+    TryAdvance();
+
+    static void
+    FreeLimbo(std::vector<Action*> *limbo);
+    
+public:
+    
+    // Register the calling thread. 
+    static void
+    Register();
+    
+    static void
+    Enter();
+    
+    static void
+    Exit();
+
+    // Free action once no thread can reach it. Frees the references held by 
+    // its DependencyInfo entries along with it. 
+    static void
+    Retire(Action *action);
+};
+
+// Take a reference on an action. 
+static inline void
+action_ref(Action *action) {
+    fetch_and_increment(&action->refcount);
+}
+
+// Drop a reference, retiring the action if it was the last one. 
+static inline void
+action_release(Action *action) {
+    if (fetch_and_decrement(&action->refcount) == 0) {
+        EpochManager::Retire(action);
+    }
+}
+
+// Remove the edge in info, if it still points to prev, and drop its 
+// reference. 
+static inline void
+cut_edge(struct DependencyInfo *info, Action *prev) {
+    if (info->Cut(prev)) {
+        action_release(prev);
+    }
+}
+
+#endif 		//  EPOCH_MANAGER_HH_
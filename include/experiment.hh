@@ -3,6 +3,7 @@
 
 #include <experiment_info.h>
 #include <concurrent_queue.h>
+#include <submit_queue.hh>
 #include <machine.h>
 #include <time.h>
 #include <tpcc.hh>
@@ -20,6 +21,9 @@ protected:
 
     SimpleQueue**
     InitQueues(int num_queues, uint32_t size);
+
+    SubmitQueue**
+    InitSubmitQueues(int num_queues, int num_producers, uint32_t size);
     
     virtual void RunTPCC() = 0;
     virtual void RunThroughput() = 0;
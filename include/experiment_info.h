@@ -10,8 +10,12 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <cstdio>
 
-#define NUM_OPTS 15
+#define NUM_OPTS 30
+
+// Options past the first NUM_BASE_OPTS are optional and fall back to defaults.
+#define NUM_BASE_OPTS 15
 
 enum ExperimentType {
     THROUGHPUT,
@@ -51,7 +55,22 @@ class ExperimentInfo {
             {"districts", required_argument, NULL, 12},
             {"customers", required_argument, NULL, 13},
             {"items", required_argument, NULL, 14},
-            { NULL, no_argument, NULL, 15}
+            {"sched_partitions", required_argument, NULL, 15},
+            {"sched_pipeline", no_argument, NULL, 16},
+            {"sched_batch", required_argument, NULL, 17},
+            {"routing", required_argument, NULL, 18},
+            {"latency_target", required_argument, NULL, 19},
+            {"streaming", no_argument, NULL, 20},
+            {"work_stealing", no_argument, NULL, 21},
+            {"idle_spin", required_argument, NULL, 22},
+            {"parallel_width", required_argument, NULL, 23},
+            {"idle_budget", required_argument, NULL, 24},
+            {"num_clients", required_argument, NULL, 25},
+            {"lock_mgr", required_argument, NULL, 26},
+            {"deterministic", no_argument, NULL, 27},
+            {"tpcc_split", required_argument, NULL, 28},
+            {"partitioned", no_argument, NULL, 29},
+            { NULL, no_argument, NULL, 30}
         };
         
         warehouses = -1;
@@ -60,6 +79,20 @@ class ExperimentInfo {
         items = -1;
         
         given_split = false;
+        sched_partitions = 1;
+        sched_pipeline = false;
+        sched_batch = 1;
+        routing = 0;
+        latency_target = 0;
+        streaming = false;
+        work_stealing = false;
+        idle_spin = 0;
+        parallel_width = 1;
+        idle_budget = 0;
+        num_clients = 1;
+        lock_mgr = 0;
+        deterministic = false;
+        partitioned = false;
 
         serial = true;
         substantiate_period = 1;
@@ -140,12 +173,71 @@ class ExperimentInfo {
             case 14:
                 items = atoi(optarg);
                 break;
+            case 15:
+                sched_partitions = atoi(optarg);
+                break;
+            case 16:
+                sched_pipeline = true;
+                break;
+            case 17:
+                sched_batch = atoi(optarg);
+                break;
+            case 18:
+                routing = atoi(optarg);
+                break;
+            case 19:
+                latency_target = atoi(optarg);
+                break;
+            case 20:
+                streaming = true;
+                break;
+            case 21:
+                work_stealing = true;
+                break;
+            case 22:
+                idle_spin = atoi(optarg);
+                break;
+            case 23:
+                parallel_width = atoi(optarg);
+                break;
+            case 24:
+                idle_budget = atoi(optarg);
+                break;
+            case 25:
+                num_clients = atoi(optarg);
+                break;
+            case 26:
+                lock_mgr = atoi(optarg);
+                break;
+            case 27:
+                deterministic = true;
+                throughput_stream.str("");
+                latency_stream.str("");
+                throughput_stream << "results/deterministic";
+                latency_stream << "results/deterministic";
+                break;
+            case 28:
+                given_split = true;
+                if (sscanf(optarg, "%u,%u,%u,%u,%u", &new_order, &district, 
+                           &stock_level, &delivery, &order_status) != 5 || 
+                    new_order + district + stock_level + delivery + 
+                    order_status == 0) {
+                    argError(long_options, NUM_OPTS);
+                }
+                break;
+            case 29:
+                partitioned = true;
+                throughput_stream.str("");
+                latency_stream.str("");
+                throughput_stream << "results/partitioned";
+                latency_stream << "results/partitioned";
+                break;
             default:
                 argError(long_options, NUM_OPTS);
             }
         }
         
-        for (int i = 0; i < NUM_OPTS; ++i) {
+        for (int i = 0; i < NUM_BASE_OPTS; ++i) {
             if (i != 10 && i != 8 && i != 0 && i != 10 && i != 11 && i != 12 &&
                 i != 13 && i != 14) {
                 if (args_received.find(i) == args_received.end()) {
@@ -166,6 +258,68 @@ class ExperimentInfo {
             experiment = (ExperimentType)exp_type;
         }
         
+        if (sched_partitions < 1 || sched_batch < 1 || routing < 0 || 
+            routing > 2 || latency_target < 0 || idle_spin < 0 || 
+            parallel_width < 1 || idle_budget < 0 || num_clients < 1 || 
+            lock_mgr < 0 || lock_mgr > 2) {
+            argError(long_options, NUM_OPTS);
+        }
+
+        // The pipeline's second stage is the single-threaded AddGraph.
+        if (sched_pipeline && sched_partitions > 1) {
+            std::cout << "sched_pipeline and sched_partitions are exclusive!\n";
+            exit(-1);
+        }
+
+        // The partitions don't tell the sequencer which actions stay sticky.
+        if (idle_budget > 0 && sched_partitions > 1) {
+            std::cout << "idle_budget and sched_partitions are exclusive!\n";
+            exit(-1);
+        }
+
+        // TPCC and peak load runs look at all their txns after the fact.
+        if (!serial && streaming && 
+            (experiment == TPCC || experiment == PEAK_LOAD)) {
+            std::cout << "Streaming only works for throughput and blind runs!\n";
+            exit(-1);
+        }
+
+        // The deterministic engine replaces the eager one's lock manager.
+        if (deterministic && (!serial || lock_mgr != 0)) {
+            std::cout << "deterministic excludes period and lock_mgr!\n";
+            exit(-1);
+        }
+
+        if (deterministic && experiment == PEAK_LOAD) {
+            std::cout << "deterministic doesn't work for peak load runs!\n";
+            exit(-1);
+        }
+
+        // Partitions are made of warehouses, one per worker.
+        if (partitioned && (!serial || lock_mgr != 0 || deterministic)) {
+            std::cout << "partitioned excludes period, lock_mgr and "
+                      << "deterministic!\n";
+            exit(-1);
+        }
+
+        if (partitioned && (experiment != TPCC || num_workers > 64)) {
+            std::cout << "partitioned only works for tpcc runs with at most 64 "
+                      << "workers!\n";
+            exit(-1);
+        }
+
+        // The lazy TPCC generator doesn't take a split yet.
+        if (given_split && (!serial || experiment != TPCC)) {
+            std::cout << "tpcc_split only works for eager tpcc runs!\n";
+            exit(-1);
+        }
+
+        // Peak load runs submit from the one thread that times them.
+        if (num_clients > 1 && experiment == PEAK_LOAD) {
+            std::cout << "num_clients doesn't work for peak load runs!\n";
+            exit(-1);
+        }
+
         if ((exp_type == TPCC) && 
             (warehouses == -1 || districts == -1 || customers == -1 || 
              items == -1)) {
@@ -196,6 +350,70 @@ class ExperimentInfo {
             latency_stream << "_threshold_" << substantiate_threshold;
         }
 
+        if (!serial && sched_partitions > 1) {
+            throughput_stream << "_partitions_" << sched_partitions;
+            latency_stream << "_partitions_" << sched_partitions;
+        }
+
+        if (!serial && sched_pipeline) {
+            throughput_stream << "_pipeline";
+            latency_stream << "_pipeline";
+        }
+
+        if (!serial && sched_batch > 1) {
+            throughput_stream << "_batch_" << sched_batch;
+            latency_stream << "_batch_" << sched_batch;
+        }
+
+        if (!serial && routing != 0) {
+            throughput_stream << "_routing_" << routing;
+            latency_stream << "_routing_" << routing;
+        }
+
+        if (!serial && latency_target > 0) {
+            throughput_stream << "_target_" << latency_target;
+            latency_stream << "_target_" << latency_target;
+        }
+
+        if (!serial && work_stealing) {
+            throughput_stream << "_stealing";
+            latency_stream << "_stealing";
+        }
+
+        if (!serial && parallel_width > 1) {
+            throughput_stream << "_width_" << parallel_width;
+            latency_stream << "_width_" << parallel_width;
+        }
+
+        if (!serial && idle_budget > 0) {
+            throughput_stream << "_budget_" << idle_budget;
+            latency_stream << "_budget_" << idle_budget;
+        }
+
+        if (idle_spin > 0) {
+            throughput_stream << "_idle_" << idle_spin;
+            latency_stream << "_idle_" << idle_spin;
+        }
+
+        if (num_clients > 1) {
+            throughput_stream << "_clients_" << num_clients;
+            latency_stream << "_clients_" << num_clients;
+        }
+
+        if (serial && lock_mgr != 0) {
+            throughput_stream << "_lockmgr_" << lock_mgr;
+            latency_stream << "_lockmgr_" << lock_mgr;
+        }
+
+        if (given_split) {
+            throughput_stream << "_split_" << new_order << "_" << district 
+                              << "_" << stock_level << "_" << delivery << "_" 
+                              << order_status;
+            latency_stream << "_split_" << new_order << "_" << district 
+                           << "_" << stock_level << "_" << delivery << "_" 
+                           << order_status;
+        }
+
         if (experiment == THROUGHPUT) {
             if (is_normal) {
                 throughput_stream << "_normal_" << std_dev;
@@ -281,6 +499,66 @@ class ExperimentInfo {
     int customers;
     int items;
 
+    // Number of threads the lazy scheduler spreads AddGraph across. Records 
+    // are hashed to a partition, each partition keeps its own dependency 
+    // tables.
+    int sched_partitions;
+
+    // Run the lazy scheduler's NowPhase and AddGraph on separate threads.
+    bool sched_pipeline;
+
+    // Number of actions the lazy scheduler adds to the dependency graph at a 
+    // time. Slots for a whole batch are prefetched before any of them are 
+    // updated.
+    int sched_batch;
+
+    // How the lazy scheduler picks a worker for a substantiated action. 
+    // 0: round robin, 1: worker owning its chains, 2: least loaded worker.
+    int routing;
+
+    // Tail latency target in microseconds for materialized txns. If set, the 
+    // lazy scheduler adapts its substantiation threshold at run time, starting
+    // from substantiate_threshold. 
+    int latency_target;
+
+    // Generate lazy txns while the experiment runs, and free them once 
+    // they're done, instead of generating all num_txns up front.
+    bool streaming;
+
+    // Let idle lazy workers take pending txns off the other workers.
+    bool work_stealing;
+
+    // Number of empty polls after which an idle thread parks until it has
+    // work again. 0 means idle threads spin.
+    int idle_spin;
+
+    // Number of a materialized txn's predecessor chains a lazy worker hands
+    // out to idle peers instead of substantiating them all itself.
+    int parallel_width;
+
+    // Number of the oldest sticky txns an idle lazy worker substantiates 
+    // ahead of time before it gets new input. 0 turns this off.
+    int idle_budget;
+
+    // Number of threads submitting txns, each through its own ring. Streaming
+    // lazy runs generate on all of them at once, other runs deal their 
+    // pre-generated txns out across the rings. 
+    int num_clients;
+
+    // Lock manager the eager workers use. 0: per-record queues under a spin 
+    // latch, 1: MCS reader-writer queue locks, 2: VLL counters.
+    int lock_mgr;
+
+    // Run the eager workloads through deterministic locking instead: one 
+    // thread grants all locks in submission order, the workers only run txns.
+    bool deterministic;
+
+    // Run TPCC partitioned by warehouse instead, H-Store style: each worker 
+    // owns a partition and runs the txns that stay in it without locking.
+    bool partitioned;
+
+    // Set by tpcc_split, along with the TPCC mix below as percentages of new
+    // order, payment, stock level, delivery and order status txns.
     bool given_split;
     
     char *experiment_string;
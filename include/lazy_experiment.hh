@@ -7,8 +7,10 @@
 #include <tpcc_table_spec.hh>
 #include <lazy_scheduler.hh>
 #include <lazy_worker.hh>
+#include <epoch_manager.hh>
 #include <machine.h>
 #include <concurrent_queue.h>
+#include <submit_queue.hh>
 #include <workload_generator.h>
 #include <tpcc_generator.hh>
 #include <normal_generator.h>
@@ -18,21 +20,67 @@
 #include <shopping_cart.h>
 
 
+// A thread that generates txns and submits them through its own ring in a 
+// streaming run with more than one client. 
+struct StreamClient {
+    WorkloadGenerator 		*gen;
+    SimpleQueue 			*ring;
+    Doorbell 				bell;			// Rung as the scheduler drains ring
+    int 					num_txns;
+    int 					num_blind;		// Last txns to materialize
+    uint64_t 				window;			// Max txns waiting in ring
+    int 					cpu;
+    pthread_t 				thread;
+
+    // Set once the client has submitted all its txns.
+    volatile uint64_t 		num_waits;
+    volatile uint64_t 		done;
+};
+
 class LazyExperiment : public Experiment {
 private:
     LazyWorker				**m_workers;
     LazyScheduler 			*m_scheduler;
-    SimpleQueue 			*m_input_queue;
+    ThresholdController 	*m_controller;
+    SubmitQueue 			*m_input_queue;
     SimpleQueue 			**m_output_queues;
     Action					**m_actions;
+    Doorbell 				m_bell;			// Rung by the output queues
+    
+    // Streaming runs
+    WorkloadGenerator 		*m_gen;
+    double 					*m_latencies;
+    int 					m_num_latencies;
+    StreamClient 			*m_clients;
 
 
     uint32_t
-    InitInputs(SimpleQueue *input_queue, int num_inputs, 
+    InitInputs(SubmitQueue *input_queue, int num_inputs, 
                WorkloadGenerator *gen);
 
+    WorkloadGenerator*
+    NewGenerator();
+
+    void
+    ConnectWorkers();
+
     void
     DoThroughputExperiment(int num_workers, uint32_t num_waits);
+
+    void
+    WaitOutput(int num_workers);
+
+    uint32_t
+    StreamInputs(int num_workers);
+
+    void
+    StartClients();
+
+    bool
+    ClientsDone(uint32_t *num_waits);
+
+    static void*
+    RunClient(void *arg);
     
     void
     InitializeTPCCWorkers(uint32_t num_workers, SimpleQueue ***inputs, 
@@ -47,6 +95,9 @@ private:
     void
     InitializeTPCCScheduler();
 
+    LazySchedulerConfig
+    SchedulerConfig();
+
     void
     WaitPeak(uint32_t duration, Action **input_actions, 
              SimpleQueue *input_queue);
@@ -12,72 +12,282 @@
 #include <table.hh>
 #include <action.h>
 #include "concurrent_queue.h"
+#include <submit_queue.hh>
 #include "cpuinfo.h"
 #include "util.h"
 #include <tpcc.hh>
 #include <lazy_worker.hh>
 #include <concurrency_control_params.hh>
 #include <runnable.hh>
+#include <threshold_controller.hh>
 
 using namespace std;
 using namespace cc_params;
 
+// The scheduler keeps one of these for every record. The last txn to touch the
+// record, whether it wrote the record and its index in that txn's read or 
+// write set are packed into a single word (see PackedDep), so an entry takes
+// 16 bytes and four records share a cache line. 
 class Heuristic {
+private:
+    uint64_t m_dep;
+
 public:
-    Action* last_txn;
-    int index;
-    bool is_write;
     int chain_length;
-
+    int owner;		// Worker the record's last substantiated chain went to
 
     Heuristic() {
-        last_txn = NULL;
-        index = -1;
-        is_write = false;
+        m_dep = PackedDep::EMPTY;
         chain_length = 0;
+        owner = -1;
     }    
+
+    inline Action*
+    LastTxn() const {
+        return PackedDep::Txn(m_dep);
+    }
+
+    inline int
+    Index() const {
+        return PackedDep::Index(m_dep);
+    }
+
+    inline bool
+    IsWrite() const {
+        return PackedDep::IsWrite(m_dep);
+    }
+
+    // The word a DependencyInfo on this record starts out with. 
+    inline uint64_t
+    Packed() const {
+        return m_dep;
+    }
+
+    inline void
+    Update(Action *txn, int index, bool is_write) {
+        assert(index >= 0);
+        m_dep = PackedDep::Pack(txn, index, is_write);
+    }
+};
+
+enum RoutingPolicy {
+    ROUND_ROBIN,
+    LOCALITY,
+    LEAST_LOADED,
+};
+
+// Knobs for the scheduler's threading. The defaults give the original 
+// single-threaded scheduler.
+struct LazySchedulerConfig {
+    int 				num_partitions;		// Number of AddGraph threads
+    int 				partition_cpu;		// CPU of the first AddGraph thread
+    bool 				pipeline;			// NowPhase and AddGraph on two threads
+    int 				pipeline_cpu;		// CPU of the AddGraph stage
+    int 				batch_size;			// Actions per AddGraph batch
+    RoutingPolicy 		routing;			// Worker choice for substantiation
+    ThresholdController *controller;		// Adapts max_chain, may be NULL
+    uint64_t 			overflow_cap;		// Per-worker overflow buffer size
+    WorkStealingDeque 	*sticky_log;		// Sticky actions by age, may be NULL
+    bool 				reclaim;			// Count references on graph edges
+
+    LazySchedulerConfig() {
+        num_partitions = 1;
+        partition_cpu = -1;
+        pipeline = false;
+        pipeline_cpu = -1;
+        batch_size = 1;
+        routing = ROUND_ROBIN;
+        controller = NULL;
+        overflow_cap = 1<<12;
+        sticky_log = NULL;
+        reclaim = false;
+    }
+};
+
+// One slice of the dependency graph when the scheduler is partitioned. Each
+// partition owns the Heuristic entries of the records that hash to it, and 
+// sees every action in the same global order, so the per-record chains agree 
+// with the serial order. 
+class SchedulerPartition : public Runnable {
+private:
+    SimpleQueue 						*m_input_queue;		// From the sequencer
+    SimpleQueue 						*m_ready_queue;		// Back to the sequencer
+    Table<uint64_t, Heuristic>			**m_tables;
+    int 								m_partition_id;
+    int 								m_num_partitions;
+    volatile int 						m_max_chain;
+    uint64_t 							m_last_seq;
+    bool 								m_reclaim;
+    Doorbell 							m_bell;			// Rung by the sequencer
+
+    void
+    AddGraph(Action *action);
+
+    void
+    Sleep();
+
+protected:
+    virtual void
+    StartWorking();
+
+public:
+    SchedulerPartition(SimpleQueue *input_queue, SimpleQueue *ready_queue, 
+                       int partition_id, int num_partitions, int cpu_number, 
+                       cc_params::TableInit *params, int num_params, 
+                       int max_chain, bool reclaim);
+
+    void
+    SetMaxChain(int max_chain) {
+        m_max_chain = max_chain;
+    }
+
+    static inline int
+    PartitionOf(const CompositeKey &record, int num_partitions) {
+        uint64_t hash = record.m_word*0x9E3779B97F4A7C15ULL;
+        return (int)((hash >> 40) % (uint64_t)num_partitions);
+    }
 };
 
 class LazyScheduler : public Runnable {
 private:
-    SimpleQueue 						*m_input_queue;
+    SubmitQueue 						*m_input_queue;		// From the clients
     SimpleQueue							**m_feedback_queues;
     SimpleQueue							**m_worker_queues;
     int 								m_num_workers;
     int 								m_cpu_number;
     Table<uint64_t, Heuristic>			**m_tables;    
     uint64_t 							m_last_used;
-    int		 							m_max_chain;
+    RoutingPolicy 						m_routing;
+    volatile int 						m_max_chain;
+    ThresholdController 				*m_controller;
     volatile uint64_t 					m_num_stickified;
-    uint64_t 							m_materialize_counter;
-    bool								m_materialize_on;
+
+    // Actions waiting for room in a worker's input queue
+    deque<Action*>						*m_overflow;
+    uint64_t 							m_overflow_cap;
+    volatile uint64_t 					m_num_overflowed;
+    volatile uint64_t 					m_num_stalls;
     //    bool 								m_is_tpcc;
     SimpleQueue 						*m_internal_queue;
     volatile uint64_t					m_internal_flag;
     pthread_t							m_pipeline_thread;
+    bool 								m_pipeline;
+    int 								m_pipeline_cpu;
     int m_dummy;
 
+    // Edges in the graph only hold references when actions are reclaimed, 
+    // which is only the case in streaming runs. 
+    bool 								m_reclaim;
+
+    // Every action AddGraph leaves sticky, oldest first, each holding a 
+    // reference. Idle workers substantiate them in the background. Once it
+    // is full, the oldest entries are dropped to make room. 
+    WorkStealingDeque 					*m_sticky_log;
+
+    // Idle scheduler threads park on these. m_bell is rung by the client, the
+    // workers and the partitions, m_graph_bell by the first stage of the 
+    // pipeline.
+    Doorbell 							m_bell;
+    Doorbell 							m_graph_bell;
+
+    // Partitioned dependency tracking
+    int 								m_num_partitions;
+    SchedulerPartition					**m_partitions;
+    SimpleQueue							**m_partition_queues;
+    SimpleQueue							**m_ready_queues;
+    uint64_t 							m_next_seq;
+
+    // Batched graph insertion
+    int 								m_batch_size;
+    vector<Action*>						m_batch;
+    vector<Heuristic*>					m_batch_slots;
+    Action 								**m_inputs;		// Dequeued inputs
 
     void
-    AddGraph(Action *txn);
+    AddGraph(Action *txn, Heuristic **slots = NULL);
+
+    void
+    AddGraphBatch();
+
+    void
+    LogSticky(Action *action);
+
+    int
+    ChooseWorker(Heuristic **deps, int num_deps);
+
+    int
+    LeastLoaded();
+
+    void
+    PollController();
+
+    void
+    Deliver(Action *action, int index);
+
+    void
+    DrainOverflow();
+
+    bool
+    HasOverflow();
+
+    bool
+    HasInput();
+
+    void
+    Idle(uint64_t *spins);
+
+    bool
+    Overloaded();
+
+    void
+    InitPartitions(const LazySchedulerConfig &config, 
+                   cc_params::TableInit *params, int num_params);
+
+    void
+    Dispatch(Action *txn);
+
+    void
+    DrainReady();
+
+    void
+    Route(Action *action);
+
+    void
+    PartitionedWorking();
     
 
     static void*
     Pipeline(void *arg);
 
+    void
+    PipelinedWorking();
+
 
 protected:
     virtual void
     StartWorking();
 
 public:
-    LazyScheduler(SimpleQueue *input_queue, SimpleQueue **feedback_queues, 
+    LazyScheduler(SubmitQueue *input_queue, SimpleQueue **feedback_queues, 
                   SimpleQueue **worker_queues, int num_workers, int cpu_number,
                   cc_params::TableInit *params, int num_params, 
-                  int max_chain);
+                  int max_chain, 
+                  LazySchedulerConfig config = LazySchedulerConfig());
 
     uint64_t
     NumStickified();
+
+    // Number of actions that had to wait in an overflow buffer.
+    uint64_t
+    NumOverflowed() {
+        return m_num_overflowed;
+    }
+
+    // Number of scheduler iterations that skipped input due to overload.
+    uint64_t
+    NumStalls() {
+        return m_num_stalls;
+    }
 };
 
 #endif // LAZY_SCHEDULER_HH_
@@ -8,6 +8,10 @@
 #include <concurrent_queue.h>
 #include <util.h>
 #include <runnable.hh>
+#include <epoch_manager.hh>
+#include <work_stealing_deque.hh>
+#include <slab_allocator.hh>
+#include <vector>
 
 enum ActionState {
     STICKY,
@@ -15,15 +19,61 @@ enum ActionState {
     SUBSTANTIATED,
 };
 
+// How far back along a record's chain try_cut looks.
+#define 	CUT_DEPTH 	8
+
+// Cut the edge in info if a walk along it can no longer find anything to 
+// substantiate: the action it points to is substantiated, and either wrote the
+// record or has itself had its edge for the record cut. Looks at most depth 
+// actions back. Returns true if the edge is gone. 
+static inline bool
+try_cut(struct DependencyInfo *info, int depth) {
+    Action *prev = info->Dependency();
+    if (prev == NULL) {
+        return true;
+    }
+    if (prev->state != SUBSTANTIATED || depth == 0) {
+        return false;
+    }
+    if (!info->IsWrite() && !try_cut(&prev->readset[info->Index()], depth-1)) {
+        return false;
+    }
+    cut_edge(info, prev);
+    return true;
+}
+
+class LazyWorker;
+
 class ActionNode {
 public:
     volatile uint64_t			start_time;
     volatile uint64_t 			end_time;
     Action 				*action;    
+    LazyWorker 			*owner;
     ActionNode 			*prev;
     ActionNode 			*next;
 };
 
+// A txn on the substantiation stack, along with where its walk of the 
+// dependency graph is at. The walk goes through the read set and then the 
+// write set, following each record's chain back from the entry. 
+struct SubstFrame {
+    Action 					*txn;
+    Action 					*prev;		// Next txn on the current chain
+    int 					index;		// prev's entry for the record
+    bool 					is_write;	// Did prev write the record?
+    bool 					on_write;	// Walking a write set chain
+    bool 					ok;			// All dependencies done so far
+    uint32_t 				next_dep;	// Next read/write set entry to walk
+};
+
+// A blind write on the blind write stack, and the next write set entry whose 
+// dependency it still has to substantiate. 
+struct BlindFrame {
+    Action 					*txn;
+    uint32_t 				next_dep;
+};
+
 class LazyWorker : public Runnable {
 private:
     SimpleQueue 			*m_input_queue;			// Txns to process
@@ -31,43 +81,140 @@ private:
     SimpleQueue 			*m_feedback_queue;		
     uint64_t				m_cpu_number;			// CPU to which to bind
     
-    // List of pending txns    
-    ActionNode 				*m_queue_head;
-    ActionNode 				*m_queue_tail;
-    long	 				m_num_elems;		
+    // Number of pending txns. Each one is parked on the action that kept it 
+    // from being substantiated, and comes back through m_inbox once that 
+    // action is done being processed. Sampled by the threshold controller.
+    volatile uint64_t 		m_num_elems;
+    volatile uint64_t __attribute__((aligned(CACHE_LINE))) m_inbox;
+    Action 					*m_blocker;		// First action we failed to claim
+    Doorbell 				m_bell;			// Rung for input and m_inbox
+
+    // Pending txns that are ready to be retried. If work stealing is on, 
+    // they go here instead of being parked, and come back here once the 
+    // action they were parked on is done, so that idle workers can take 
+    // them while this worker is busy. 
+    WorkStealingDeque		*m_stealable;
+    LazyWorker 				**m_peers;
+    int 					m_num_peers;
+    int 					m_id;					// Index in m_peers
+    bool 					m_steal;
+    volatile uint64_t 		m_num_steals;
+
+    // Predecessors of the materialized txn this worker is substantiating, 
+    // published so that idle peers can substantiate them in parallel. Each
+    // one holds a reference, dropped by whoever takes it. 
+    WorkStealingDeque 		*m_help;
+    int 					m_parallel_width;
+    volatile uint64_t 		m_num_helped;
+
+    // Sticky txns in the order the scheduler added them to the graph. Once
+    // its input and wait list are empty, a worker substantiates up to 
+    // m_idle_budget of the oldest ones before it gets new input again.
+    WorkStealingDeque 		*m_sticky_log;
+    uint64_t 				m_idle_budget;
+    uint64_t 				m_budget_left;
+    volatile uint64_t 		m_num_background;
 
     volatile uint32_t		m_num_done;
+    volatile uint64_t 		m_num_cas_failures;		// Lost races on Action::state
+    volatile uint64_t 		m_max_depth;			// Deepest substantiation stack
+
+    // Explicit stacks for walking the dependency graph, so that chains of any
+    // length can be substantiated without recursing. 
+    std::vector<SubstFrame> m_stack;
+    std::vector<BlindFrame> m_blind_stack;
+
+    // Counters for the threshold controller, only kept if a latency target 
+    // is set.
+    uint64_t 				m_latency_target;		// In microseconds
+    volatile uint64_t 		m_idle_cycles;
+    volatile uint64_t 		m_num_materialized;
+    volatile uint64_t 		m_num_slow;				// Took over the target
+    
+    // Drop the submitter's reference on actions that leave the system 
+    // without reaching the output queue.
+    bool 					m_reclaim;
+
+    void
+    CutEdges(Action *txn);
+
+    void
+    Output(Action *txn);
+
+    void
+    RecordLatency(Action *txn);
+
+    void
+    Wait(Action *txn);
 
     void
+    Completed(Action *txn);
+
+    bool
     CheckWaits();
 
+    bool
+    Steal();
+
     void
-    Enqueue(ActionNode *txn);
+    Fork(Action *txn);
 
     void
-    RemoveQueue(ActionNode *txn);
+    Help(Action *txn);
 
-    ActionNode				*m_free_list;		// Free-list of ActionNodes
+    bool
+    StealHelp();
 
     void
-    InitActionNodes();
+    Background();
+
+    bool
+    HasWork();
+
+    void
+    Sleep();
+
+    void
+    Block(Action *txn);
+
+    void
+    Park(ActionNode *node);
+
+    void
+    Deliver(ActionNode *node);
+
+    void
+    Retry(ActionNode *node);
+
+    // Wait list nodes. Only as many as ever wait at once are allocated, from
+    // the NUMA node of the worker's cpu. 
+    SlabAllocator<ActionNode> *m_nodes;
     
-    // Get an action node from the free-list
+    // Get an action node from the slab
     inline ActionNode*
     GetActionNode();
     
-    // Return a list of action nodes to the free-list
+    // Return an action node to the slab
     inline void
     ReturnActionNode(ActionNode *node);
 
     bool
-    ProcessTxn(Action *txn);
+    Claim(Action *txn);
+
+    void
+    PushFrame(Action *txn);
+
+    Action*
+    NextDependency(SubstFrame *frame);
+
+    void
+    ChainResult(SubstFrame *frame, bool done);
 
     bool
-    processRead(Action *action, int readIndex);
+    FinishTxn(Action *txn, bool ok);
 
     bool
-    processWrite(struct DependencyInfo *info);
+    Substantiate(Action *txn);
     
     bool
     ProcessBlindInner(Action *action);
@@ -90,6 +237,100 @@ public:
     NumDone() {
         return m_num_done;
     }
+
+    uint64_t
+    NumCasFailures() {
+        return m_num_cas_failures;
+    }
+
+    uint64_t
+    NumSteals() {
+        return m_num_steals;
+    }
+
+    uint64_t
+    NumHelped() {
+        return m_num_helped;
+    }
+
+    uint64_t
+    NumBackground() {
+        return m_num_background;
+    }
+
+    void
+    SetStickyLog(WorkStealingDeque *log, uint64_t budget) {
+        m_sticky_log = log;
+        m_idle_budget = budget;
+        m_budget_left = budget;
+    }
+
+    // Connect this worker to the others in peers. If steal is set, it steals
+    // pending txns from them and lets them steal from it. 
+    void
+    SetPeers(LazyWorker **peers, int num_peers, int id, bool steal) {
+        m_peers = peers;
+        m_num_peers = num_peers;
+        m_id = id;
+        m_steal = steal;
+    }
+
+    // Hand out up to width predecessor chains of each materialized txn to 
+    // the peers. 
+    void
+    SetParallelWidth(int width) {
+        uint64_t size = 1;
+        while (size < (uint64_t)width) {
+            size <<= 1;
+        }
+        m_parallel_width = width;
+        m_help = new WorkStealingDeque(size);
+    }
+
+    // txn just left PROCESSING, or the last scheduler partition just finished
+    // with it. Sends everything parked on it back to its worker. 
+    static void
+    Wake(Action *txn);
+
+    uint64_t
+    NodesHighWater() {
+        return m_nodes->HighWater();
+    }
+
+    uint64_t
+    MaxDepth() {
+        return m_max_depth;
+    }
+
+    void
+    SetReclaim(bool reclaim) {
+        m_reclaim = reclaim;
+    }
+
+    void
+    SetLatencyTarget(uint64_t usecs) {
+        m_latency_target = usecs;
+    }
+
+    uint64_t
+    NumIdleCycles() {
+        return m_idle_cycles;
+    }
+
+    uint64_t
+    NumMaterialized() {
+        return m_num_materialized;
+    }
+
+    uint64_t
+    NumSlow() {
+        return m_num_slow;
+    }
+
+    uint64_t
+    NumWaiting() {
+        return m_num_elems + m_stealable->Size();
+    }
 };
 
 #endif 		//  LAZY_WORKER_HH_
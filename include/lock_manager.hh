@@ -23,7 +23,32 @@ struct TxnQueue {
     }
 };
 
-class LockManager {    
+// What EagerWorker acquires its txns' locks through, so experiments can swap
+// in different lock managers.
+class EagerLockManager {
+protected:
+
+    // Push txn, which now holds all its locks, on its worker's ready stack.
+    static void
+    Ready(EagerAction *txn);
+
+public:
+    virtual
+    ~EagerLockManager() { }
+
+    // Returns true if txn got all its locks right away. Otherwise the txn 
+    // gets pushed on txn->ready once it holds them.
+    virtual bool
+    Lock(EagerAction *txn) = 0;
+
+    virtual void
+    Unlock(EagerAction *txn) = 0;
+
+    virtual void
+    Kill(EagerAction *txn) = 0;
+};
+
+class LockManager : public EagerLockManager {    
 private:
     Table<uint64_t, TxnQueue>		**m_tables;    
 
@@ -42,6 +67,9 @@ private:
               struct EagerRecordInfo **prev,
               struct EagerRecordInfo **next);
 
+    void
+    Grant(EagerAction *txn);
+
     void
     AdjustRead(struct EagerRecordInfo *dep);
 
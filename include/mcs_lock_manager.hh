@@ -0,0 +1,75 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		MCS_LOCK_MANAGER_HH_
+#define 		MCS_LOCK_MANAGER_HH_
+
+#include <lock_manager.hh>
+#include <concurrency_control_params.hh>
+
+// Mellor-Crummey and Scott's fair reader-writer queue lock, one per record.
+// Requests are the txns' EagerRecordInfos. A request joins the queue with a
+// single swap on tail, and whoever releases the lock hands it straight to the
+// requests behind it, so there's no latch around the queue.
+struct McsLock {
+    volatile uint64_t __attribute((aligned(CACHE_LINE))) 	tail;
+    volatile uint64_t 										reader_count;
+    volatile uint64_t 										next_writer;
+
+    McsLock() {
+        tail = 0;
+        reader_count = 0;
+        next_writer = 0;
+    }
+};
+
+// Lock manager on top of McsLock. Requests can't be withdrawn from an MCS
+// queue, so a txn that enqueued on one record while waiting on another could
+// deadlock against a txn that did the same in the other order. Instead a txn
+// requests its locks one at a time in sorted order, and only once it holds
+// the previous one. If a request has to wait, whoever grants it carries on
+// requesting the txn's remaining locks, and pushes the txn on its worker's
+// ready stack once it holds them all.
+class McsLockManager : public EagerLockManager {
+private:
+    Table<uint64_t, McsLock>		**m_tables;
+
+    // Request dep's lock. Returns true if it was granted right away.
+    bool
+    Acquire(struct EagerRecordInfo *dep);
+
+    void
+    Release(struct EagerRecordInfo *dep);
+
+    // Mark dep as holding its lock. Returns the reader queued behind dep that
+    // now gets the lock too, if any.
+    struct EagerRecordInfo*
+    Granted(struct EagerRecordInfo *dep);
+
+    // Grant dep, which is waiting, its lock.
+    void
+    Unblock(struct EagerRecordInfo *dep);
+
+    // Request txn's remaining locks. Returns true once it holds them all,
+    // false if it has to wait for one.
+    bool
+    Continue(EagerAction *txn);
+
+    // Continue the txns this thread granted a lock to.
+    void
+    RunGranted();
+
+public:
+    McsLockManager(cc_params::TableInit *params, int num_params);
+
+    virtual bool
+    Lock(EagerAction *txn);
+
+    virtual void
+    Unlock(EagerAction *txn);
+
+    virtual void
+    Kill(EagerAction *txn);
+};
+
+#endif 		//  MCS_LOCK_MANAGER_HH_
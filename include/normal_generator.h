@@ -6,6 +6,8 @@
 #include <random>
 #include <cassert>
 #include <eager_generator.hh>
+#include <object_pool.hh>
+#include <simple_action.hh>
 
 class NormalGenerator : public WorkloadGenerator {
     
@@ -16,6 +18,9 @@ class NormalGenerator : public WorkloadGenerator {
     int m_freq;
     int m_std_dev;
 
+    // Txns come back here once they're retired. 
+    ObjectPool<simple::SimpleAction> *m_pool;
+
     virtual int genUnique(std::default_random_engine* generator,
                           std::normal_distribution<double>* dist,
                           std::set<int>* done);
@@ -0,0 +1,115 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		OBJECT_POOL_HH_
+#define 		OBJECT_POOL_HH_
+
+#include <cassert>
+#include <new>
+#include <utility>
+#include <vector>
+#include <numa.h>
+#include <stdint.h>
+#include <machine.h>
+#include <util.h>
+
+// The part of an ObjectPool that other threads see. Objects come back here
+// from whichever thread frees them, and the owner takes them all back in one
+// go once it runs out.
+class PoolBase {
+protected:
+    struct FreeNode {
+        FreeNode 										*next;
+    };
+
+    volatile uint64_t __attribute__((aligned(CACHE_LINE))) m_returned;
+
+    FreeNode*
+    TakeReturned() {
+        if (m_returned == 0) {
+            return NULL;
+        }
+        return (FreeNode*)xchgq(&m_returned, 0);
+    }
+
+public:
+    PoolBase() {
+        m_returned = 0;
+    }
+
+    virtual ~PoolBase() { }
+
+    // Any thread. obj's destructor must already have run.
+    void
+    Return(void *obj) {
+        FreeNode *node = (FreeNode*)obj;
+        uint64_t head;
+        do {
+            head = m_returned;
+            node->next = (FreeNode*)head;
+        } while (!cmp_and_swap(&m_returned, head, (uint64_t)node));
+    }
+};
+
+// Objects of type T for a single allocating thread. Memory comes in slabs of
+// slab_size objects from the thread's NUMA node, and is only ever reused, so
+// a thread that frees objects as fast as it makes them stays at a fixed
+// footprint. T must have a PoolBase* member called pool, which is how the
+// freeing thread finds its way back.
+template<class T>
+class ObjectPool : public PoolBase {
+private:
+    uint32_t 							m_slab_size;
+    FreeNode 							*m_free_list;
+    std::vector<T*> 					m_slabs;
+
+    void
+    Grow() {
+        T *slab = (T*)numa_alloc_local(sizeof(T)*m_slab_size);
+        assert(slab != NULL);
+        m_slabs.push_back(slab);
+        for (uint32_t i = m_slab_size; i > 0; --i) {
+            FreeNode *node = (FreeNode*)&slab[i-1];
+            node->next = m_free_list;
+            m_free_list = node;
+        }
+    }
+
+public:
+    ObjectPool(uint32_t slab_size = 1<<10) {
+        assert(sizeof(T) >= sizeof(FreeNode));
+        m_slab_size = slab_size;
+        m_free_list = NULL;
+    }
+
+    // Objects still out when the pool goes away are leaked.
+    ~ObjectPool() {
+        for (size_t i = 0; i < m_slabs.size(); ++i) {
+            numa_free(m_slabs[i], sizeof(T)*m_slab_size);
+        }
+    }
+
+    // Owner only.
+    template<typename... Args>
+    T*
+    Get(Args&&... args) {
+        if (m_free_list == NULL) {
+            m_free_list = TakeReturned();
+            if (m_free_list == NULL) {
+                Grow();
+            }
+        }
+        FreeNode *node = m_free_list;
+        m_free_list = node->next;
+        T *ret = new (node) T(std::forward<Args>(args)...);
+        ret->pool = this;
+        return ret;
+    }
+
+    uint64_t
+    Capacity() {
+        return (uint64_t)m_slabs.size()*m_slab_size;
+    }
+};
+
+#endif 		//  OBJECT_POOL_HH_
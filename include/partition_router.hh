@@ -0,0 +1,67 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		PARTITION_ROUTER_HH_
+#define 		PARTITION_ROUTER_HH_
+
+#include <partition_worker.hh>
+#include <concurrent_queue.h>
+#include <submit_queue.hh>
+#include <runnable.hh>
+#include <doorbell.hh>
+
+// Number of txns the router moves between queues at a time.
+#define PARTITION_BATCH 		32
+
+// Sends txns to the PartitionWorkers that own the warehouses they touch. It is
+// the only producer on every partition's queue, so all partitions see the
+// multi-partition txns they share in the same order, and none of them can
+// wait on a txn another is stuck behind. Workers hand back txns whose next
+// link needs other partitions, and chains that are done.
+class PartitionRouter : public Runnable {
+private:
+    SubmitQueue 				*m_input_queue;
+    SimpleQueue 				**m_partition_queues;
+    SimpleQueue 				**m_done_queues;
+    int 						m_num_partitions;
+    int 						m_next_partition;	// For txns with no records
+
+    // Txns that have been routed but not handed back yet, at most m_window.
+    // Keeps the partition and done queues from filling up.
+    uint32_t 					m_num_active;
+    uint32_t 					m_window;
+    volatile uint64_t 			m_num_multi;
+
+    Doorbell 					m_bell;			// Rung for input and done txns
+
+    void
+    Route(EagerAction *txn);
+
+    void
+    Finish(EagerAction *txn);
+
+    bool
+    HasWork();
+
+    void
+    Sleep();
+
+protected:
+    virtual void
+    StartWorking();
+
+public:
+    // window must be at most the size of each partition and done queue.
+    PartitionRouter(SubmitQueue *input_queue, SimpleQueue **partition_queues,
+                    SimpleQueue **done_queues, int num_partitions,
+                    uint32_t window, int cpu);
+
+    // Number of txns, counting each link of a chain, that touched more than
+    // one partition.
+    uint64_t
+    NumMultiPartition() {
+        return m_num_multi;
+    }
+};
+
+#endif 		//  PARTITION_ROUTER_HH_
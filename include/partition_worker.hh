@@ -0,0 +1,75 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		PARTITION_WORKER_HH_
+#define 		PARTITION_WORKER_HH_
+
+#include <action.h>
+#include <tpcc.hh>
+#include <concurrent_queue.h>
+#include <runnable.hh>
+#include <doorbell.hh>
+
+// Warehouses are dealt out to partitions round robin.
+static inline int
+partition_of(const CompositeKey &record, int num_partitions) {
+    return tpcc::TPCCKeyGen::get_warehouse_key(record.m_key) % num_partitions;
+}
+
+// Mask of the partitions txn touches, 0 if it touches no records.
+static inline uint64_t
+txn_partitions(EagerAction *txn, int num_partitions) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < txn->readset.size(); ++i) {
+        mask |= 1ULL << partition_of(txn->readset[i].record, num_partitions);
+    }
+    for (size_t i = 0; i < txn->writeset.size(); ++i) {
+        mask |= 1ULL << partition_of(txn->writeset[i].record, num_partitions);
+    }
+    return mask;
+}
+
+// Owns the warehouses of one partition, H-Store style: txns that only touch
+// this partition run back to back, without any locks. A txn that touches
+// several partitions is queued at all of them. Each of them stops when it
+// gets to it, the last one to get there runs it and then lets the others go.
+// A txn whose next link stays in the partition runs it right away, anything
+// else goes back to the PartitionRouter.
+class PartitionWorker : public Runnable {
+private:
+    int 					m_partition;
+    int 					m_num_partitions;
+    SimpleQueue 			*m_input_queue;			// From the router
+    SimpleQueue 			*m_done_queue;			// Back to the router
+    SimpleQueue 			*m_output_queue;		// Finished txns
+    volatile uint32_t 		m_num_done;
+
+    // One per partition, ours is rung for input and when a multi-partition
+    // txn we're waiting on has run.
+    Doorbell 				*m_bells;
+
+    void
+    Wait(EagerAction *txn);
+
+    void
+    Release(EagerAction *txn, uint64_t partitions);
+
+    void
+    Process(EagerAction *txn);
+
+protected:
+    virtual void
+    StartWorking();
+
+public:
+    PartitionWorker(int partition, int num_partitions,
+                    SimpleQueue *input_queue, SimpleQueue *done_queue,
+                    SimpleQueue *output_queue, Doorbell *bells, int cpu);
+
+    uint32_t
+    NumProcessed() {
+        return m_num_done;
+    }
+};
+
+#endif 		//  PARTITION_WORKER_HH_
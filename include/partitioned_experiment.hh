@@ -0,0 +1,39 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		PARTITIONED_EXPERIMENT_HH_
+#define 		PARTITIONED_EXPERIMENT_HH_
+
+#include <eager_experiment.hh>
+#include <partition_router.hh>
+#include <partition_worker.hh>
+
+// Runs TPCC H-Store style: every PartitionWorker owns the warehouses of one
+// partition and runs the txns that stay in it without any concurrency
+// control, a PartitionRouter sends txns to the partitions they touch.
+class PartitionedExperiment : public EagerExperiment {
+private:
+    PartitionRouter 			*m_router;
+    PartitionWorker 			**m_partition_workers;
+
+protected:
+    virtual void
+    StartWorkers();
+
+    virtual void
+    RunTPCC();
+
+    virtual void
+    RunThroughput();
+
+    virtual void
+    RunPeak();
+
+    virtual void
+    RunBlind();
+
+public:
+    PartitionedExperiment(ExperimentInfo *info);
+};
+
+#endif 		//  PARTITIONED_EXPERIMENT_HH_
@@ -7,6 +7,7 @@
 #include <set>
 #include <simple_action.hh>
 #include <eager_generator.hh>
+#include <object_pool.hh>
 #include <algorithm>
 
 class ShoppingCart : public WorkloadGenerator {
@@ -23,6 +24,11 @@ class ShoppingCart : public WorkloadGenerator {
   std::vector<int> m_client_indices;
   std::set<int> m_index_set;
 
+  // Txns come back to these once they're retired.
+  ObjectPool<shopping::ClearCart> *m_clear_pool;
+  ObjectPool<shopping::Checkout> *m_checkout_pool;
+  ObjectPool<shopping::AddItemAction> *m_add_pool;
+
  public:
   ShoppingCart(int num_clients, 
 	       int num_records, 
@@ -37,6 +43,9 @@ class ShoppingCart : public WorkloadGenerator {
     m_cart_size = 40;
     m_freq = freq;
     m_next_client = 0;
+    m_clear_pool = new ObjectPool<shopping::ClearCart>();
+    m_checkout_pool = new ObjectPool<shopping::Checkout>();
+    m_add_pool = new ObjectPool<shopping::AddItemAction>();
     
 
     std::cout << "frequency: " << m_freq << "\n";
@@ -75,14 +84,14 @@ class ShoppingCart : public WorkloadGenerator {
           for (size_t i = 0; i < 250; ++i) {
               to_write[i] = (uint32_t)rand();
           }
-          ret = new shopping::ClearCart(to_write);
+          ret = m_clear_pool->Get(to_write);
           ret->is_blind = true;
           ret->writeset.push_back(fake);
       }
       // Regular checkout. 
       else {
           
-          ret = new shopping::Checkout();
+          ret = m_checkout_pool->Get();
           ret->writeset.push_back(fake);
 
           int cnt = 0;
@@ -109,7 +118,7 @@ class ShoppingCart : public WorkloadGenerator {
     
     // Otherwise keep adding to the cart. 
     else {	
-        ret = new shopping::AddItemAction();
+        ret = m_add_pool->Get();
         ret->writeset.push_back(fake);
         ret->materialize = false;
         ret->is_blind = false;
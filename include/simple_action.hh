@@ -190,6 +190,10 @@ namespace shopping {
             to_write = input;
         }
 
+        virtual ~ClearCart() {
+            free(to_write);
+        }
+
         virtual bool
         NowPhase() {
             return true;
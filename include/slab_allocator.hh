@@ -0,0 +1,99 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		SLAB_ALLOCATOR_HH_
+#define 		SLAB_ALLOCATOR_HH_
+
+#include <cassert>
+#include <new>
+#include <vector>
+#include <numa.h>
+#include <stdint.h>
+
+// Single threaded allocator for fixed size objects. Memory comes in slabs of
+// slab_size objects from the NUMA node of the cpu the owner is pinned to, and
+// a new slab is only allocated once all the others are in use. Slabs are
+// never returned to the system before the allocator is destroyed.
+template<class T>
+class SlabAllocator {
+private:
+    struct FreeNode {
+        FreeNode 					*next;
+    };
+
+    int 							m_numa_node;
+    uint32_t 						m_slab_size;
+    FreeNode 						*m_free_list;
+    std::vector<T*> 				m_slabs;
+
+    uint64_t 						m_in_use;
+    volatile uint64_t 				m_high_water;	// Most objects ever in use
+
+    void
+    Grow() {
+        size_t size = sizeof(T)*m_slab_size;
+        T *slab = (T*)numa_alloc_onnode(size, m_numa_node);
+        assert(slab != NULL);
+        m_slabs.push_back(slab);
+        for (uint32_t i = m_slab_size; i > 0; --i) {
+            FreeNode *node = (FreeNode*)&slab[i-1];
+            node->next = m_free_list;
+            m_free_list = node;
+        }
+    }
+
+public:
+    SlabAllocator(int cpu, uint32_t slab_size = 1<<10) {
+        assert(sizeof(T) >= sizeof(FreeNode));
+        m_numa_node = numa_node_of_cpu(cpu);
+        if (m_numa_node < 0) {
+            m_numa_node = 0;
+        }
+        m_slab_size = slab_size;
+        m_free_list = NULL;
+        m_in_use = 0;
+        m_high_water = 0;
+    }
+
+    ~SlabAllocator() {
+        for (size_t i = 0; i < m_slabs.size(); ++i) {
+            numa_free(m_slabs[i], sizeof(T)*m_slab_size);
+        }
+    }
+
+    T*
+    Get() {
+        if (m_free_list == NULL) {
+            Grow();
+        }
+        FreeNode *node = m_free_list;
+        m_free_list = node->next;
+        m_in_use += 1;
+        if (m_in_use > m_high_water) {
+            m_high_water = m_in_use;
+        }
+        return new (node) T();
+    }
+
+    void
+    Put(T *obj) {
+        obj->~T();
+        FreeNode *node = (FreeNode*)obj;
+        node->next = m_free_list;
+        m_free_list = node;
+        assert(m_in_use > 0);
+        m_in_use -= 1;
+    }
+
+    uint64_t
+    HighWater() {
+        return m_high_water;
+    }
+
+    uint64_t
+    Capacity() {
+        return (uint64_t)m_slabs.size()*m_slab_size;
+    }
+};
+
+#endif 		//  SLAB_ALLOCATOR_HH_
@@ -0,0 +1,127 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		SMALL_VECTOR_HH_
+#define 		SMALL_VECTOR_HH_
+
+#include <arena.hh>
+#include <cassert>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+
+// Vector that keeps its first N elements inline, and moves to a buffer from
+// the Arena once it grows past them. Only has the parts of std::vector that
+// txns use for their read and write sets. Iterators are plain pointers, and
+// are invalidated by push_back. Not copyable.
+template<class T, uint32_t N>
+class SmallVector {
+private:
+    T 													*m_data;
+    uint32_t 											m_size;
+    uint32_t 											m_capacity;
+    typename std::aligned_storage<sizeof(T)*N,
+                                  __alignof__(T)>::type	m_inline;
+
+    SmallVector(const SmallVector &other);
+    SmallVector& operator=(const SmallVector &other);
+
+    inline bool
+    IsInline() const {
+        return m_data == (T*)&m_inline;
+    }
+
+    void
+    Grow() {
+        uint32_t capacity = 2*m_capacity;
+        T *data = (T*)Arena::Alloc(sizeof(T)*capacity);
+        for (uint32_t i = 0; i < m_size; ++i) {
+            new (&data[i]) T(m_data[i]);
+            m_data[i].~T();
+        }
+        if (!IsInline()) {
+            Arena::Free(m_data, sizeof(T)*m_capacity);
+        }
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+public:
+    typedef T* 				iterator;
+    typedef const T* 		const_iterator;
+
+    SmallVector() {
+        m_data = (T*)&m_inline;
+        m_size = 0;
+        m_capacity = N;
+    }
+
+    ~SmallVector() {
+        clear();
+        if (!IsInline()) {
+            Arena::Free(m_data, sizeof(T)*m_capacity);
+        }
+    }
+
+    inline void
+    push_back(const T &value) {
+        if (m_size == m_capacity) {
+            Grow();
+        }
+        new (&m_data[m_size]) T(value);
+        m_size += 1;
+    }
+
+    // Keeps the buffer around for the next push_back.
+    void
+    clear() {
+        for (uint32_t i = 0; i < m_size; ++i) {
+            m_data[i].~T();
+        }
+        m_size = 0;
+    }
+
+    inline size_t
+    size() const {
+        return m_size;
+    }
+
+    inline bool
+    empty() const {
+        return m_size == 0;
+    }
+
+    inline T&
+    operator[](size_t index) {
+        assert(index < m_size);
+        return m_data[index];
+    }
+
+    inline const T&
+    operator[](size_t index) const {
+        assert(index < m_size);
+        return m_data[index];
+    }
+
+    inline iterator
+    begin() {
+        return m_data;
+    }
+
+    inline iterator
+    end() {
+        return m_data + m_size;
+    }
+
+    inline const_iterator
+    begin() const {
+        return m_data;
+    }
+
+    inline const_iterator
+    end() const {
+        return m_data + m_size;
+    }
+};
+
+#endif 		//  SMALL_VECTOR_HH_
@@ -0,0 +1,116 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		SUBMIT_QUEUE_HH_
+#define 		SUBMIT_QUEUE_HH_
+
+#include <concurrent_queue.h>
+#include <cassert>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Multiple producer, single consumer queue for submitting txns. Every
+// producer gets a SimpleQueue of its own, so producers never contend with
+// each other and each one's txns come out in the order it put them in. The
+// consumer takes from the rings in turn. There is no order across producers
+// until the consumer picks one, so the serial order is simply the order in
+// which the consumer dequeues.
+class SubmitQueue {
+private:
+    SimpleQueue 					**m_rings;
+    int 							m_num_rings;
+    int 							m_next;			// Consumer's next ring
+
+    inline void
+    Advance() {
+        if (++m_next == m_num_rings) {
+            m_next = 0;
+        }
+    }
+
+public:
+    // The rings split size between them, rounded up to a power of two.
+    SubmitQueue(int num_producers, uint64_t size) {
+        assert(num_producers > 0);
+        uint64_t ring_size = 1;
+        while (ring_size*num_producers < size) {
+            ring_size <<= 1;
+        }
+        m_rings = new SimpleQueue*[num_producers];
+        for (int i = 0; i < num_producers; ++i) {
+            char *data = (char*)malloc(sizeof(uint64_t)*ring_size);
+            assert(data != NULL);
+            m_rings[i] = new SimpleQueue(data, ring_size);
+        }
+        m_num_rings = num_producers;
+        m_next = 0;
+    }
+
+    int
+    NumProducers() {
+        return m_num_rings;
+    }
+
+    // The ring producer index enqueues to. Must only be used by one thread.
+    SimpleQueue*
+    Producer(int index) {
+        assert(index >= 0 && index < m_num_rings);
+        return m_rings[index];
+    }
+
+    void
+    SetConsumer(Doorbell *not_empty) {
+        for (int i = 0; i < m_num_rings; ++i) {
+            m_rings[i]->SetConsumer(not_empty);
+        }
+    }
+
+    bool
+    isEmpty() {
+        for (int i = 0; i < m_num_rings; ++i) {
+            if (!m_rings[i]->isEmpty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Only a snapshot, the producers keep going.
+    uint64_t
+    Size() {
+        uint64_t ret = 0;
+        for (int i = 0; i < m_num_rings; ++i) {
+            ret += m_rings[i]->Size();
+        }
+        return ret;
+    }
+
+    // Consumer only. Moves on to the next ring after every value, so a busy
+    // producer can't starve the others.
+    bool
+    Dequeue(uint64_t *value) {
+        for (int i = 0; i < m_num_rings; ++i) {
+            SimpleQueue *ring = m_rings[m_next];
+            Advance();
+            if (ring->Dequeue(value)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Consumer only. Takes up to max values, going around the rings at most
+    // once.
+    uint32_t
+    DequeueBatch(uint64_t *data, uint32_t max) {
+        uint32_t num = 0;
+        for (int i = 0; i < m_num_rings && num < max; ++i) {
+            SimpleQueue *ring = m_rings[m_next];
+            Advance();
+            num += ring->DequeueBatch(data + num, max - num);
+        }
+        return num;
+    }
+};
+
+#endif 		//  SUBMIT_QUEUE_HH_
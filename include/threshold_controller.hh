@@ -0,0 +1,69 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+// 
+
+#ifndef 		THRESHOLD_CONTROLLER_HH_
+#define 		THRESHOLD_CONTROLLER_HH_
+
+#include <lazy_worker.hh>
+#include <stdint.h>
+
+// Adjusts the lazy scheduler's chain length threshold while an experiment 
+// runs. Every window the controller looks at the workers' counters. If more 
+// than 1% of materialized txns took longer than the latency target, or the 
+// workers' wait lists are backing up, the threshold is halved. Otherwise, if 
+// the workers have idle time to spare, it grows by a fixed step so that txns 
+// stay sticky for longer. 
+class ThresholdController {
+private:
+    LazyWorker 				**m_workers;
+    int 					m_num_workers;
+    int 					m_threshold;
+    int 					m_min_threshold;
+    int 					m_max_threshold;
+    int 					m_step;
+    uint64_t 				m_window;			// In rdtsc cycles
+    uint64_t 				m_window_start;
+    
+    // Worker counters at the start of the current window
+    uint64_t 				m_last_idle;
+    uint64_t 				m_last_materialized;
+    uint64_t 				m_last_slow;
+
+    uint64_t 				m_num_increases;
+    uint64_t 				m_num_decreases;
+
+    void
+    Adjust(uint64_t elapsed);
+
+public:
+    ThresholdController(LazyWorker **workers, int num_workers, 
+                        int initial_threshold, uint64_t latency_target);
+    
+    // Called by the scheduler thread. Returns the threshold to use. 
+    inline int
+    Poll() {
+        uint64_t now = rdtsc();
+        if (now - m_window_start >= m_window) {
+            Adjust(now - m_window_start);
+            m_window_start = now;
+        }
+        return m_threshold;
+    }
+
+    int
+    Threshold() {
+        return m_threshold;
+    }
+
+    uint64_t
+    NumIncreases() {
+        return m_num_increases;
+    }
+
+    uint64_t
+    NumDecreases() {
+        return m_num_decreases;
+    }
+};
+
+#endif 		//  THRESHOLD_CONTROLLER_HH_
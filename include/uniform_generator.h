@@ -6,6 +6,8 @@
 #include <time.h>
 #include <set>
 #include <eager_generator.hh>
+#include <object_pool.hh>
+#include <simple_action.hh>
 
 class UniformGenerator : public WorkloadGenerator {
     
@@ -17,6 +19,9 @@ class UniformGenerator : public WorkloadGenerator {
 
     uint64_t **m_perfect_set;
 
+    // Txns come back here once they're retired. 
+    ObjectPool<simple::SimpleAction> *m_pool;
+
     virtual int genUnique(std::set<int>* done);
 
     virtual void gen_perfect_set(int num_threads);
@@ -0,0 +1,78 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		VLL_LOCK_MANAGER_HH_
+#define 		VLL_LOCK_MANAGER_HH_
+
+#include <lock_manager.hh>
+#include <concurrency_control_params.hh>
+
+// Number of txns that can be between requesting their locks and releasing
+// them at once. Must be a power of two.
+#define VLL_RING_SIZE 	(1<<14)
+
+// All VLL keeps per record: the number of txns that have requested it
+// exclusively and shared, and haven't released it yet.
+struct VllCounters {
+    volatile uint64_t 		cx;
+    volatile uint64_t 		cs;
+
+    VllCounters() {
+        cx = 0;
+        cs = 0;
+    }
+};
+
+// One txn in request order. word holds the txn's sequence number and state,
+// so a thread that fell behind can't mistake a newer txn in the same slot for
+// the one it was looking for.
+struct VllSlot {
+    volatile uint64_t 		word;
+    EagerAction 			*txn;
+};
+
+// Very Lightweight Locking (Ren, Thomson and Abadi). A txn bumps the counters
+// of every record it touches, all at once under a single request latch, and
+// is free to run if nobody was ahead of it on any of them. Otherwise it's
+// blocked until every txn that requested its locks before it has released
+// them, at which point it's pushed on its worker's ready stack. Releasing is
+// just decrementing the counters.
+class VllLockManager : public EagerLockManager {
+private:
+    Table<uint64_t, VllCounters>		**m_tables;
+
+    // Serializes requests, which gives txns their order.
+    volatile uint64_t __attribute((aligned(CACHE_LINE))) 	m_latch;
+    uint64_t 												m_next_seq;
+
+    // Sequence number of the oldest txn that hasn't released its locks.
+    volatile uint64_t __attribute((aligned(CACHE_LINE))) 	m_head;
+    VllSlot 												*m_slots;
+
+    inline VllCounters*
+    Counters(struct EagerRecordInfo *dep) {
+        VllCounters *ret =
+            m_tables[dep->record.m_table]->GetPtr(dep->record.m_key);
+        assert(ret != NULL);
+        return ret;
+    }
+
+    // Move m_head past txns that are done, and hand out the new oldest txn if
+    // it's blocked.
+    void
+    Advance();
+
+public:
+    VllLockManager(cc_params::TableInit *params, int num_params);
+
+    virtual bool
+    Lock(EagerAction *txn);
+
+    virtual void
+    Unlock(EagerAction *txn);
+
+    virtual void
+    Kill(EagerAction *txn);
+};
+
+#endif 		//  VLL_LOCK_MANAGER_HH_
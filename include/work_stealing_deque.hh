@@ -0,0 +1,93 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#ifndef 		WORK_STEALING_DEQUE_HH_
+#define 		WORK_STEALING_DEQUE_HH_
+
+#include <cassert>
+#include <stdlib.h>
+#include <stdint.h>
+#include <machine.h>
+#include <util.h>
+
+// Bounded Chase-Lev deque. The owning thread pushes and pops at the bottom,
+// any other thread can steal from the top. Relies on x86's store ordering, so
+// the only fences are the xchgq in Pop and the CAS races on m_top.
+class WorkStealingDeque {
+private:
+    uint64_t 											*m_values;
+    uint64_t 											m_size;
+    volatile uint64_t __attribute__((aligned(CACHE_LINE)))	m_top;
+    volatile uint64_t __attribute__((aligned(CACHE_LINE)))	m_bottom;
+
+public:
+    WorkStealingDeque(uint64_t size) {
+        assert(!(size & (size-1)));
+        m_values = (uint64_t*)malloc(sizeof(uint64_t)*size);
+        m_size = size;
+        m_top = 0;
+        m_bottom = 0;
+    }
+
+    // Only a snapshot if called by a thread other than the owner.
+    uint64_t Size() {
+        uint64_t top = m_top;
+        uint64_t bottom = m_bottom;
+        return bottom > top? bottom - top : 0;
+    }
+
+    // Owner only. Returns false if the deque is full.
+    bool Push(uint64_t data) {
+        uint64_t bottom = m_bottom;
+        if (bottom - m_top >= m_size) {
+            return false;
+        }
+        m_values[bottom & (m_size-1)] = data;
+        asm volatile("":::"memory");
+        m_bottom = bottom + 1;
+        return true;
+    }
+
+    // Owner only. Takes the most recently pushed element.
+    bool Pop(uint64_t *data) {
+        uint64_t bottom = m_bottom;
+        if (bottom == m_top) {
+            return false;
+        }
+        bottom -= 1;
+        xchgq(&m_bottom, bottom);
+        uint64_t top = m_top;
+        if (top > bottom) {
+            m_bottom = bottom + 1;
+            return false;
+        }
+        *data = m_values[bottom & (m_size-1)];
+        if (top == bottom) {
+
+            // Last element, race the thieves for it.
+            bool won = cmp_and_swap(&m_top, top, top+1);
+            m_bottom = bottom + 1;
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread. Takes the oldest element, fails if the deque is empty or
+    // another thread got to it first.
+    bool Steal(uint64_t *data) {
+        uint64_t top = m_top;
+        asm volatile("":::"memory");
+        uint64_t bottom = m_bottom;
+        if (top >= bottom) {
+            return false;
+        }
+        uint64_t value = m_values[top & (m_size-1)];
+        if (!cmp_and_swap(&m_top, top, top+1)) {
+            return false;
+        }
+        *data = value;
+        return true;
+    }
+};
+
+#endif 		//  WORK_STEALING_DEQUE_HH_
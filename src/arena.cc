@@ -0,0 +1,86 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <arena.hh>
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+#include <util.h>
+
+__thread Arena::ThreadState *Arena::t_state = NULL;
+
+// Never freed, blocks from a thread's chunks may outlive the thread.
+Arena::ThreadState*
+Arena::State() {
+    if (t_state == NULL) {
+        void *state;
+        int err = posix_memalign(&state, CACHE_LINE, sizeof(ThreadState));
+        assert(err == 0);
+        t_state = (ThreadState*)state;
+        memset(t_state, 0, sizeof(ThreadState));
+    }
+    return t_state;
+}
+
+void*
+Arena::Alloc(size_t size) {
+    if (size > ((size_t)1 << ARENA_MAX_SHIFT)) {
+        void *ret = malloc(size);
+        assert(ret != NULL);
+        return ret;
+    }
+
+    ThreadState *me = State();
+    int size_class = SizeClass(size);
+    FreeBlock *block = me->free_lists[size_class];
+    if (block == NULL && me->returned[size_class] != 0) {
+        block = (FreeBlock*)xchgq(&me->returned[size_class], 0);
+    }
+    if (block != NULL) {
+        me->free_lists[size_class] = block->next;
+        return block;
+    }
+
+    // Whatever is left of the current chunk is abandoned if it's too small.
+    size_t block_size = (size_t)1 << size_class;
+    if (me->cursor + block_size > me->end) {
+        void *chunk;
+        int err = posix_memalign(&chunk, ARENA_CHUNK, ARENA_CHUNK);
+        assert(err == 0);
+        *(ThreadState**)chunk = me;
+        me->cursor = (char*)chunk + ARENA_HEADER;
+        me->end = (char*)chunk + ARENA_CHUNK;
+        me->num_chunks += 1;
+    }
+    void *ret = me->cursor;
+    me->cursor += block_size;
+    return ret;
+}
+
+void
+Arena::Free(void *ptr, size_t size) {
+    if (size > ((size_t)1 << ARENA_MAX_SHIFT)) {
+        free(ptr);
+        return;
+    }
+    ThreadState *owner = Owner(ptr);
+    int size_class = SizeClass(size);
+    FreeBlock *block = (FreeBlock*)ptr;
+    if (owner == t_state) {
+        block->next = owner->free_lists[size_class];
+        owner->free_lists[size_class] = block;
+        return;
+    }
+
+    uint64_t head;
+    do {
+        head = owner->returned[size_class];
+        block->next = (FreeBlock*)head;
+    } while (!cmp_and_swap(&owner->returned[size_class], head, 
+                           (uint64_t)block));
+}
+
+uint64_t
+Arena::NumChunks() {
+    return State()->num_chunks;
+}
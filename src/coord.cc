@@ -2,12 +2,22 @@
 #include <experiment.hh>
 #include <eager_experiment.hh>
 #include <lazy_experiment.hh>
+#include <deterministic_experiment.hh>
+#include <partitioned_experiment.hh>
+#include <doorbell.hh>
 
 int
 main(int argc, char** argv) {
     ExperimentInfo* info = new ExperimentInfo(argc, argv);
+    Doorbell::s_spin_limit = info->idle_spin;
     Experiment *expt;
-    if (info->serial) {
+    if (info->deterministic) {
+        expt = new DeterministicExperiment(info);
+    }
+    else if (info->partitioned) {
+        expt = new PartitionedExperiment(info);
+    }
+    else if (info->serial) {
         expt = new EagerExperiment(info);        
     }
     else {
@@ -0,0 +1,82 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <deterministic_experiment.hh>
+
+DeterministicExperiment::DeterministicExperiment(ExperimentInfo *info)
+    : EagerExperiment(info) {
+    m_engine = "deterministic";
+}
+
+void
+DeterministicExperiment::StartWorkers() {
+    for (int i = 0; i < m_info->num_workers; ++i) {
+        m_det_workers[i]->Run();
+    }
+    m_scheduler->Run();
+}
+
+// The scheduler runs on cpu 0, the workers on the next num_workers cpus.
+void
+DeterministicExperiment::RunDeterministic(TableInit *params, int num_params) {
+    int num_workers = m_info->num_workers;
+    DeterministicLockManager *lock_mgr =
+        new DeterministicLockManager(params, num_params);
+
+    // All txns go through the scheduler, in the order the clients submit them.
+    SubmitQueue *input_queue = new SubmitQueue(m_info->num_clients,
+                                               LARGE_QUEUE);
+    SimpleQueue **worker_queues = InitQueues(num_workers, SMALL_QUEUE);
+    SimpleQueue **done_queues = InitQueues(num_workers, SMALL_QUEUE);
+    SimpleQueue **output_queues = InitQueues(num_workers, LARGE_QUEUE);
+
+    m_scheduler = new DeterministicScheduler(lock_mgr, input_queue,
+                                             worker_queues, done_queues,
+                                             num_workers, SMALL_QUEUE, 0);
+    m_det_workers = new DeterministicWorker*[num_workers];
+    for (int i = 0; i < num_workers; ++i) {
+        m_det_workers[i] = new DeterministicWorker(worker_queues[i],
+                                                   done_queues[i],
+                                                   output_queues[i], i+1);
+    }
+
+    InitInputs(&input_queue, m_info->num_txns, 1, NewGenerator());
+    DoThroughputExperiment(output_queues, num_workers,
+                           (uint32_t)m_info->num_txns);
+}
+
+void
+DeterministicExperiment::RunTPCC() {
+    RunDeterministic(InitializeTPCCParams(), tpcc::s_num_tables);
+    WriteNewOrderCDF();
+    WriteStockCDF();
+}
+
+void
+DeterministicExperiment::RunThroughput() {
+    TableInit table_init_params[1];
+    table_init_params[0].m_table_type = ONE_DIM_TABLE;
+    table_init_params[0].m_params.m_one_params.m_dim1 = m_info->num_records;
+
+    RunDeterministic(table_init_params, 1);
+    WriteLatencies();
+}
+
+void
+DeterministicExperiment::RunBlind() {
+    TableInit table_init_params[2];
+    table_init_params[0].m_table_type = ONE_DIM_TABLE;
+    table_init_params[0].m_params.m_one_params.m_dim1 = 2000;
+
+    table_init_params[1].m_table_type = ONE_DIM_TABLE;
+    table_init_params[1].m_params.m_one_params.m_dim1 = 1000000;
+
+    RunDeterministic(table_init_params, 2);
+    WriteBlindLatencies();
+}
+
+// ExperimentInfo turns peak load runs away.
+void
+DeterministicExperiment::RunPeak() {
+    assert(false);
+}
@@ -0,0 +1,140 @@
+// Author: Kun Ren (kun@cs.yale.edu)
+//
+// Lock manager implementing deterministic two-phase locking as described in
+// 'The Case for Determinism in Database Systems'.
+
+#include <deterministic_lock_manager.hh>
+
+using namespace cc_params;
+
+DeterministicLockManager::DeterministicLockManager(TableInit *params,
+                                                   int num_params) {
+    m_tables = do_tbl_init<DeterministicQueue>(params, num_params);
+    assert(m_tables != NULL);
+    m_ready_head = NULL;
+    m_ready_tail = NULL;
+}
+
+bool
+DeterministicLockManager::Request(EagerAction *txn,
+                                  struct EagerRecordInfo *dep) {
+    DeterministicQueue *queue =
+        m_tables[dep->record.m_table]->GetPtr(dep->record.m_key);
+    assert(queue != NULL);
+
+    dep->dependency = txn;
+    dep->next = NULL;
+    dep->prev = queue->tail;
+    if (queue->tail != NULL) {
+        queue->tail->next = dep;
+    }
+    else {
+        queue->head = dep;
+    }
+    queue->tail = dep;
+
+    // A write request fails if there is any previous request at all, a read
+    // request if there is a previous write request.
+    struct EagerRecordInfo *prev = dep->prev;
+    dep->is_held = (prev == NULL ||
+                    (!dep->is_write && !prev->is_write && prev->is_held));
+    return dep->is_held;
+}
+
+bool
+DeterministicLockManager::Lock(EagerAction *txn) {
+    txn->num_dependencies = 0;
+    txn->finished_execution = false;
+    for (size_t i = 0; i < txn->writeset.size(); ++i) {
+        txn->writeset[i].is_write = true;
+        if (!Request(txn, &txn->writeset[i])) {
+            txn->num_dependencies += 1;
+        }
+    }
+    for (size_t i = 0; i < txn->readset.size(); ++i) {
+        txn->readset[i].is_write = false;
+        if (!Request(txn, &txn->readset[i])) {
+            txn->num_dependencies += 1;
+        }
+    }
+    return txn->num_dependencies == 0;
+}
+
+void
+DeterministicLockManager::Grant(struct EagerRecordInfo *dep) {
+    assert(!dep->is_held);
+    dep->is_held = true;
+    EagerAction *txn = dep->dependency;
+    if (--txn->num_dependencies == 0) {
+        txn->next = NULL;
+        if (m_ready_tail != NULL) {
+            m_ready_tail->next = txn;
+        }
+        else {
+            m_ready_head = txn;
+        }
+        m_ready_tail = txn;
+    }
+}
+
+void
+DeterministicLockManager::Release(struct EagerRecordInfo *dep) {
+    assert(dep->is_held);
+    DeterministicQueue *queue =
+        m_tables[dep->record.m_table]->GetPtr(dep->record.m_key);
+    assert(queue != NULL);
+
+    struct EagerRecordInfo *prev = dep->prev;
+    struct EagerRecordInfo *next = dep->next;
+    if (prev != NULL) {
+        prev->next = next;
+    }
+    else {
+        queue->head = next;
+    }
+    if (next != NULL) {
+        next->prev = prev;
+    }
+    else {
+        queue->tail = prev;
+    }
+
+    // Grant subsequent request(s) if:
+    //  (a) The released request held a write lock.
+    //  (b) The released request held a read lock ALONE.
+    // A write lock is only ever held at the front of the queue, and a write
+    // request behind a read can only be granted once the read is at the front.
+    if (next != NULL && prev == NULL && (dep->is_write || next->is_write)) {
+        if (next->is_write) {
+            Grant(next);
+        }
+        else {
+            for (; next != NULL && !next->is_write; next = next->next) {
+                Grant(next);
+            }
+        }
+    }
+}
+
+void
+DeterministicLockManager::Release(EagerAction *txn) {
+    for (size_t i = 0; i < txn->writeset.size(); ++i) {
+        Release(&txn->writeset[i]);
+    }
+    for (size_t i = 0; i < txn->readset.size(); ++i) {
+        Release(&txn->readset[i]);
+    }
+    txn->finished_execution = true;
+}
+
+EagerAction*
+DeterministicLockManager::NextReady() {
+    EagerAction *ret = m_ready_head;
+    if (ret != NULL) {
+        m_ready_head = ret->next;
+        if (m_ready_head == NULL) {
+            m_ready_tail = NULL;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,126 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <deterministic_scheduler.hh>
+#include <time.h>
+
+DeterministicScheduler::DeterministicScheduler(DeterministicLockManager
+                                               *lock_mgr,
+                                               SubmitQueue *input_queue,
+                                               SimpleQueue **worker_queues,
+                                               SimpleQueue **done_queues,
+                                               int num_workers,
+                                               uint32_t window, int cpu)
+    : Runnable(cpu) {
+    assert(num_workers > 0 && window > 0);
+    m_lock_mgr = lock_mgr;
+    m_input_queue = input_queue;
+    m_worker_queues = worker_queues;
+    m_done_queues = done_queues;
+    m_num_workers = num_workers;
+    m_next_worker = 0;
+    m_num_active = 0;
+    m_window = window;
+
+    m_input_queue->SetConsumer(&m_bell);
+    for (int i = 0; i < num_workers; ++i) {
+        m_worker_queues[i]->SetProducer(&m_bell);
+        m_done_queues[i]->SetConsumer(&m_bell);
+    }
+}
+
+void
+DeterministicScheduler::Send(EagerAction *txn) {
+    m_worker_queues[m_next_worker]->EnqueueBlocking((uint64_t)txn);
+    if (++m_next_worker == m_num_workers) {
+        m_next_worker = 0;
+    }
+}
+
+void
+DeterministicScheduler::Start(EagerAction *txn) {
+    if (m_lock_mgr->Lock(txn)) {
+        Send(txn);
+    }
+}
+
+// txn has run. Its successor in a chain takes its place in the window, and
+// its latency starts counting now.
+void
+DeterministicScheduler::Finish(EagerAction *txn) {
+    m_lock_mgr->Release(txn);
+    EagerAction *link;
+    if (txn->IsLinked(&link)) {
+        clock_gettime(CLOCK_REALTIME, &link->start_time);
+        link->start_rdtsc_time = rdtsc();
+        Start(link);
+    }
+    else {
+        m_num_active -= 1;
+    }
+}
+
+bool
+DeterministicScheduler::HasWork() {
+    for (int i = 0; i < m_num_workers; ++i) {
+        if (!m_done_queues[i]->isEmpty()) {
+            return true;
+        }
+    }
+    return m_num_active < m_window && !m_input_queue->isEmpty();
+}
+
+// Sleep until a worker hands back a txn or a client submits one.
+void
+DeterministicScheduler::Sleep() {
+    uint32_t seq = m_bell.Prepare();
+    if (HasWork()) {
+        m_bell.Cancel();
+    }
+    else {
+        m_bell.Wait(seq);
+    }
+}
+
+void
+DeterministicScheduler::StartWorking() {
+    EagerAction *txns[DETERMINISTIC_BATCH];
+    uint64_t spins = 0;
+    while (true) {
+        bool idle = true;
+
+        // Releases first, they make room in the window.
+        for (int i = 0; i < m_num_workers; ++i) {
+            uint32_t num = m_done_queues[i]->DequeueBatch((uint64_t*)txns,
+                                                          DETERMINISTIC_BATCH);
+            for (uint32_t j = 0; j < num; ++j) {
+                Finish(txns[j]);
+            }
+            idle = idle && (num == 0);
+        }
+        EagerAction *txn;
+        while ((txn = m_lock_mgr->NextReady()) != NULL) {
+            Send(txn);
+        }
+
+        uint32_t room = m_window - m_num_active;
+        if (room > DETERMINISTIC_BATCH) {
+            room = DETERMINISTIC_BATCH;
+        }
+        uint32_t num = m_input_queue->DequeueBatch((uint64_t*)txns, room);
+        for (uint32_t i = 0; i < num; ++i) {
+            clock_gettime(CLOCK_REALTIME, &txns[i]->start_time);
+            txns[i]->start_rdtsc_time = rdtsc();
+            m_num_active += 1;
+            Start(txns[i]);
+        }
+        idle = idle && (num == 0);
+
+        if (!idle) {
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            Sleep();
+        }
+    }
+}
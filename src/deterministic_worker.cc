@@ -0,0 +1,42 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <deterministic_worker.hh>
+#include <time.h>
+
+DeterministicWorker::DeterministicWorker(SimpleQueue *input_queue,
+                                         SimpleQueue *done_queue,
+                                         SimpleQueue *output_queue, int cpu)
+    : Runnable(cpu) {
+    m_input_queue = input_queue;
+    m_done_queue = done_queue;
+    m_output_queue = output_queue;
+    m_num_done = 0;
+    m_input_queue->SetConsumer(&m_bell);
+    m_done_queue->SetProducer(&m_bell);
+    m_output_queue->SetProducer(&m_bell);
+}
+
+void
+DeterministicWorker::StartWorking() {
+    while (true) {
+        EagerAction *txn = (EagerAction*)m_input_queue->DequeueBlocking();
+        assert(txn->num_dependencies == 0);
+        txn->Execute();
+        txn->PostExec();
+
+        // The scheduler requests the locks of the next txn in the chain once
+        // this one has released its own.
+        EagerAction *link;
+        bool linked = txn->IsLinked(&link);
+        if (!linked) {
+            m_num_done += 1;
+            clock_gettime(CLOCK_REALTIME, &txn->end_time);
+            txn->end_rdtsc_time = rdtsc();
+        }
+        m_done_queue->EnqueueBlocking((uint64_t)txn);
+        if (!linked) {
+            m_output_queue->EnqueueBlocking((uint64_t)txn);
+        }
+    }
+}
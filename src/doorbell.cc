@@ -0,0 +1,6 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <doorbell.hh>
+
+uint64_t Doorbell::s_spin_limit = 0;
@@ -9,10 +9,25 @@ using namespace std;
 
 EagerExperiment::EagerExperiment(ExperimentInfo *info) 
     : Experiment(info) {
+    m_engine = "eager";
+    m_clients = NULL;
 }
 
-void
-EagerExperiment::InitializeTPCCLockManager() {
+EagerLockManager*
+EagerExperiment::NewLockManager(TableInit *params, int num_params) {
+    switch (m_info->lock_mgr) {
+    case 1:
+        return new McsLockManager(params, num_params);
+    case 2:
+        return new VllLockManager(params, num_params);
+    default:
+        return new LockManager(params, num_params);
+    }
+}
+
+// Lock tables for TPCC, one per TPCC table. 
+TableInit*
+EagerExperiment::InitializeTPCCParams() {
     using namespace tpcc;
     using namespace cc_params;
 
@@ -60,19 +75,61 @@ EagerExperiment::InitializeTPCCLockManager() {
             exit(-1);
         }
     }
-    m_lock_mgr = new LockManager(lock_mgr_params, s_num_tables);
+    return lock_mgr_params;
+}
+
+void
+EagerExperiment::InitializeTPCCLockManager() {
+    m_lock_mgr = NewLockManager(InitializeTPCCParams(), tpcc::s_num_tables);
+}
+
+EagerGenerator*
+EagerExperiment::NewGenerator() {
+    switch (m_info->experiment) {
+    case TPCC:
+        if (m_info->given_split) {
+            return new EagerTPCCGenerator(m_info->new_order, m_info->district, 
+                                          m_info->stock_level, 
+                                          m_info->delivery, 
+                                          m_info->order_status);
+        }
+        return new EagerTPCCGenerator(45, 43, 4, 4, 4);
+    case BLIND:
+        return new EagerShoppingCart(2000, 1000000, 20, 
+                                     m_info->blind_write_frequency, 0);
+    default:
+        if (m_info->is_normal) {
+            return new EagerNormalGenerator(m_info->read_set_size, 
+                                            m_info->write_set_size, 
+                                            m_info->num_records, 
+                                            m_info->substantiate_period, 
+                                            m_info->std_dev);
+        }
+        return new EagerUniformGenerator(m_info->read_set_size, 
+                                         m_info->write_set_size, 
+                                         m_info->num_records, 
+                                         m_info->substantiate_period);
+    }
 }
 
 
+// With a single client, txns are dealt out over the workers before the run 
+// starts. With more, the clients generate and submit them while it runs, 
+// and DoThroughputExperiment waits for them to finish.
 void
-EagerExperiment::InitInputs(SimpleQueue **input_queues, int num_inputs, int num_workers,
+EagerExperiment::InitInputs(SubmitQueue **input_queues, int num_inputs, int num_workers,
                             EagerGenerator *gen) {
+    m_actions = (EagerAction**)malloc(sizeof(EagerAction*)*num_inputs);
+    if (m_info->num_clients > 1) {
+        StartClients(input_queues, num_inputs, num_workers, gen);
+        return;
+    }
+
     //    uint32_t no, pay, stock, 
     timespec zero_time;
     zero_time.tv_sec = 0;
     zero_time.tv_nsec = 0;
     
-    m_actions = (EagerAction**)malloc(sizeof(EagerAction*)*num_inputs);
     for (int i = 0; i < num_inputs; ++i) {
         EagerAction *txn = gen->genNext();
         m_actions[i] = txn;
@@ -80,12 +137,67 @@ EagerExperiment::InitInputs(SimpleQueue **input_queues, int num_inputs, int num_
         m_actions[i]->end_time = zero_time;
         m_actions[i]->start_rdtsc_time = 0;
         m_actions[i]->end_rdtsc_time = 0;        
-        input_queues[i%num_workers]->EnqueueBlocking((uint64_t)txn);
+        input_queues[i%num_workers]->Producer(0)->EnqueueBlocking((uint64_t)txn);
+    }
+}
+
+// Each client takes every num_clients'th txn, with a generator of its own, 
+// and deals them out over the workers through its own rings. Clients go on 
+// the cpus after the one DoThroughputExperiment runs on.
+void
+EagerExperiment::StartClients(SubmitQueue **input_queues, int num_inputs, 
+                              int num_workers, EagerGenerator *gen) {
+    int num_clients = m_info->num_clients;
+    m_clients = new EagerClient[num_clients];
+    for (int i = 0; i < num_clients; ++i) {
+        EagerClient *client = &m_clients[i];
+        client->gen = i == 0? gen : NewGenerator();
+        client->queues = input_queues;
+        client->num_queues = num_workers;
+        client->actions = m_actions;
+        client->num_inputs = num_inputs;
+        client->id = i;
+        client->num_clients = num_clients;
+        client->cpu = m_info->num_workers + 2 + i;
+        for (int j = 0; j < num_workers; ++j) {
+            input_queues[j]->Producer(i)->SetProducer(&client->bell);
+        }
+        pthread_create(&client->thread, NULL, RunClient, client);
+    }
+}
+
+void
+EagerExperiment::JoinClients() {
+    for (int i = 0; m_clients != NULL && i < m_info->num_clients; ++i) {
+        pthread_join(m_clients[i].thread, NULL);
     }
 }
 
+void*
+EagerExperiment::RunClient(void *arg) {
+    EagerClient *client = (EagerClient*)arg;
+    pin_thread(client->cpu);
+    timespec zero_time;
+    zero_time.tv_sec = 0;
+    zero_time.tv_nsec = 0;
+
+    int num_submitted = 0;
+    for (int i = client->id; i < client->num_inputs; i += client->num_clients) {
+        EagerAction *txn = client->gen->genNext();
+        client->actions[i] = txn;
+        txn->start_time = zero_time;
+        txn->end_time = zero_time;
+        txn->start_rdtsc_time = 0;
+        txn->end_rdtsc_time = 0;
+        SubmitQueue *queue = client->queues[num_submitted % client->num_queues];
+        queue->Producer(client->id)->EnqueueBlocking((uint64_t)txn);
+        num_submitted += 1;
+    }
+    return NULL;
+}
+
 EagerWorker**
-EagerExperiment::InitWorkers(int num_workers, SimpleQueue **input_queues, 
+EagerExperiment::InitWorkers(int num_workers, SubmitQueue **input_queues, 
                              SimpleQueue **output_queues, int cpu_offset) {
     EagerWorker **ret = new EagerWorker*[num_workers];
     for (int i = 0; i < num_workers; ++i) {
@@ -96,8 +208,14 @@ EagerExperiment::InitWorkers(int num_workers, SimpleQueue **input_queues,
 }
 
 void
-EagerExperiment::DoThroughputExperiment(EagerWorker **workers, 
-                                        SimpleQueue **output_queues, 
+EagerExperiment::StartWorkers() {
+    for (int i = 0; i < m_info->num_workers; ++i) {
+        m_workers[i]->Run();
+    }
+}
+
+void
+EagerExperiment::DoThroughputExperiment(SimpleQueue **output_queues, 
                                         int num_workers, uint32_t num_waits) {
     
     // Bind this thread to a particular cpu to avoid interfering with workers
@@ -107,25 +225,53 @@ EagerExperiment::DoThroughputExperiment(EagerWorker **workers,
         exit(-1);
     }
     
-    // Start the workers
+    // The output queues wake us up if we park waiting on them. 
     for (int i = 0; i < num_workers; ++i) {
-        workers[i]->Run();
+        output_queues[i]->SetConsumer(&m_bell);
     }
+
+    StartWorkers();
     
+    // Our cpu time stops counting while we're parked.
+    clockid_t clock = CLOCK_THREAD_CPUTIME_ID;
+    if (Doorbell::s_spin_limit != 0) {
+        clock = CLOCK_MONOTONIC;
+    }
     timespec start_time, end_time;
-    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start_time);
+    clock_gettime(clock, &start_time);
 
-    // Spin until the workers have finished processing their inputs
+    // Spin until the workers have finished processing their inputs, park if 
+    // they take too long. 
     uint32_t num_done = 0;
+    uint64_t spins = 0;
     while (num_done < num_waits) {
+        bool idle = true;
         for (int i = 0; i < num_workers; ++i) {
             uint64_t dummy;
             if (output_queues[i]->Dequeue(&dummy)) {
                 ++num_done;
+                idle = false;
+            }
+        }
+        if (!idle) {
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            uint32_t seq = m_bell.Prepare();
+            bool empty = true;
+            for (int i = 0; i < num_workers; ++i) {
+                empty = empty && output_queues[i]->isEmpty();
+            }
+            if (empty) {
+                m_bell.Wait(seq);
+            }
+            else {
+                m_bell.Cancel();
             }
         }
     }
-    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end_time);
+    clock_gettime(clock, &end_time);
+    JoinClients();
     
     timespec diff = diff_time(end_time, start_time);
     WriteThroughput(diff, num_waits);
@@ -149,7 +295,7 @@ EagerExperiment::WriteStockCDF() {
         }
     }
     stringstream no_file;
-    no_file << "results/eager_" << m_info->warehouses << "_threads_" << m_info->num_workers << "_stock.txt";
+    no_file << "results/" << m_engine << "_" << m_info->warehouses << "_threads_" << m_info->num_workers << "_stock.txt";
     ofstream cdf_file;
     cdf_file.open(no_file.str(), ios::out);
 
@@ -175,7 +321,7 @@ EagerExperiment::WriteNewOrderCDF() {
     }
 
     stringstream no_file;
-    no_file << "results/eager_" << m_info->warehouses << "_threads_" << m_info->num_workers << "_neworder.txt";
+    no_file << "results/" << m_engine << "_" << m_info->warehouses << "_threads_" << m_info->num_workers << "_neworder.txt";
     ofstream cdf_file;
     cdf_file.open(no_file.str(), ios::out);
 
@@ -195,25 +341,18 @@ EagerExperiment::RunTPCC() {
     InitializeTPCCLockManager();
     
     // These queues will hold input to each worker thread
-    SimpleQueue **input_queues = InitQueues(m_info->num_workers, LARGE_QUEUE);
+    SubmitQueue **input_queues = InitSubmitQueues(m_info->num_workers, 
+                                                  m_info->num_clients, 
+                                                  LARGE_QUEUE);
     SimpleQueue **output_queues = InitQueues(m_info->num_workers, LARGE_QUEUE);
     
     // Initialize the workload generator
-    EagerTPCCGenerator txn_generator;
-    if (m_info->given_split) {
-        txn_generator = EagerTPCCGenerator(m_info->new_order, m_info->district, 
-                                           m_info->stock_level, m_info->delivery,
-                                           m_info->order_status);
-    }
-    else {
-        txn_generator = EagerTPCCGenerator(45, 43, 4, 4, 4);
-    }
-    InitInputs(input_queues, m_info->num_txns, m_info->num_workers, &txn_generator);    
-    EagerWorker **workers = InitWorkers(m_info->num_workers, input_queues, 
-                                        output_queues, 0);
-
+    InitInputs(input_queues, m_info->num_txns, m_info->num_workers, 
+               NewGenerator());    
+    m_workers = InitWorkers(m_info->num_workers, input_queues, output_queues, 
+                            0);
     
-    DoThroughputExperiment(workers, output_queues, m_info->num_workers, 
+    DoThroughputExperiment(output_queues, m_info->num_workers, 
                            (uint32_t)m_info->num_txns);    
     WriteNewOrderCDF();
     WriteStockCDF();
@@ -228,18 +367,20 @@ EagerExperiment::RunBlind() {
     table_init_params[1].m_table_type = ONE_DIM_TABLE;
     table_init_params[1].m_params.m_one_params.m_dim1 = 1000000;
 
-    m_lock_mgr = new LockManager(table_init_params, 2);
+    m_lock_mgr = NewLockManager(table_init_params, 2);
     
-    SimpleQueue **input_queues = InitQueues(m_info->num_workers, LARGE_QUEUE);
+    SubmitQueue **input_queues = InitSubmitQueues(m_info->num_workers, 
+                                                  m_info->num_clients, 
+                                                  LARGE_QUEUE);
     SimpleQueue **output_queues = InitQueues(m_info->num_workers, LARGE_QUEUE);
     
     // Initialize the workload generator
-    EagerGenerator *gen = new EagerShoppingCart(2000, 1000000, 20, m_info->blind_write_frequency, 0);
-    EagerWorker **workers = InitWorkers(m_info->num_workers, input_queues, 
-                                        output_queues, 0);
+    EagerGenerator *gen = NewGenerator();
+    m_workers = InitWorkers(m_info->num_workers, input_queues, output_queues, 
+                            0);
 
     InitInputs(input_queues, m_info->num_txns, m_info->num_workers, gen);
-    DoThroughputExperiment(workers, output_queues, m_info->num_workers, 
+    DoThroughputExperiment(output_queues, m_info->num_workers, 
                            (uint32_t)m_info->num_txns);    
     WriteBlindLatencies();    
 }
@@ -264,10 +405,11 @@ EagerExperiment::RunPeak() {
     }
 
     // Create the lock manager
-    m_lock_mgr = new LockManager(table_init_params, 1);    
+    m_lock_mgr = NewLockManager(table_init_params, 1);    
     
     // Create the workers
-    SimpleQueue **input_queues = InitQueues(m_info->num_workers, SMALL_QUEUE);
+    SubmitQueue **input_queues = InitSubmitQueues(m_info->num_workers, 1, 
+                                                  SMALL_QUEUE);
     SimpleQueue **output_queues = InitQueues(m_info->num_workers, LARGE_QUEUE);
     EagerWorker **workers = InitWorkers(m_info->num_workers, input_queues, 
                                         output_queues, 1);
@@ -455,27 +597,17 @@ EagerExperiment::RunThroughput() {
     table_init_params[0].m_table_type = ONE_DIM_TABLE;
     table_init_params[0].m_params.m_one_params.m_dim1 = m_info->num_records;
 
-    m_lock_mgr = new LockManager(table_init_params, 1);
+    m_lock_mgr = NewLockManager(table_init_params, 1);
     
-    SimpleQueue **input_queues = InitQueues(m_info->num_workers, LARGE_QUEUE);
+    SubmitQueue **input_queues = InitSubmitQueues(m_info->num_workers, 
+                                                  m_info->num_clients, 
+                                                  LARGE_QUEUE);
     SimpleQueue **output_queues = InitQueues(m_info->num_workers, LARGE_QUEUE);
     
     // Initialize the workload generator
-    EagerGenerator *gen = NULL;
-    if (m_info->is_normal) {
-        gen = new EagerNormalGenerator(m_info->read_set_size, 
-                                       m_info->write_set_size, 
-                                       m_info->num_records, 
-                                       m_info->substantiate_period, 
-                                       m_info->std_dev);
-    }
-    else {
-        gen = new EagerUniformGenerator(m_info->read_set_size, 
-                                        m_info->write_set_size, m_info->num_records, 
-                                        m_info->substantiate_period);
-    }
-    EagerWorker **workers = InitWorkers(m_info->num_workers, input_queues, 
-                                        output_queues, 0);
+    EagerGenerator *gen = NewGenerator();
+    m_workers = InitWorkers(m_info->num_workers, input_queues, output_queues, 
+                            0);
     /*
     SimpleQueue **sched_input = InitQueues(1, LARGE_QUEUE);
 
@@ -486,7 +618,7 @@ EagerExperiment::RunThroughput() {
     */
 
     InitInputs(input_queues, m_info->num_txns, m_info->num_workers, gen);
-    DoThroughputExperiment(workers, output_queues, m_info->num_workers, 
+    DoThroughputExperiment(output_queues, m_info->num_workers, 
                            (uint32_t)m_info->num_txns);    
     WriteLatencies();        
 }
@@ -504,6 +636,23 @@ EagerExperiment::WriteLatencies() {
 }
 
 
+// Latency of every TPCC txn, from the start of its first link to the end of
+// its last.
+void
+EagerExperiment::WriteTPCCLatencies() {
+    double *times = (double*)malloc(sizeof(double)*m_info->num_txns);
+    for (int i = 0; i < m_info->num_txns; ++i) {
+        EagerAction *last = m_actions[i], *link;
+        while (last->IsLinked(&link)) {
+            last = link;
+        }
+        timespec diff = diff_time(last->end_time, m_actions[i]->start_time);
+        times[i] = (1000000.0*diff.tv_sec) + (diff.tv_nsec/1000.0);
+    }
+    WriteCDF(times, m_info->num_txns);
+    free(times);
+}
+
 void
 EagerExperiment::WriteBlindLatencies() {
     double *times = (double*)malloc(sizeof(double)*m_info->num_txns);
@@ -739,7 +739,7 @@ DeliveryEager1::Execute() {
 }
 
 int
-DeliveryEager1::GetIndex(const std::vector<struct EagerRecordInfo> &info, uint32_t size, 
+DeliveryEager1::GetIndex(const EagerRecordSet &info, uint32_t size, 
                          const struct EagerRecordInfo &cmp) {
     for (uint32_t j = 0; j < size; ++j) {
         assert(info[j].record.m_table == cmp.record.m_table);
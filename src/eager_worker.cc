@@ -3,17 +3,18 @@
 
 #include <eager_worker.hh>
 
-EagerWorker::EagerWorker(LockManager *mgr, SimpleQueue *input_queue, 
+EagerWorker::EagerWorker(EagerLockManager *mgr, SubmitQueue *input_queue, 
                          SimpleQueue *output_queue, int cpu) 
     : Runnable(cpu) {
     m_lock_mgr = mgr;
     m_txn_input_queue = input_queue;
     m_output_queue = output_queue;
     m_cpu_number = cpu;
-    m_queue_head = NULL;
-    m_queue_tail = NULL;    
     m_num_elems = 0;
+    m_ready = 0;
     m_num_done = 0;
+    m_txn_input_queue->SetConsumer(&m_bell);
+    m_output_queue->SetProducer(&m_bell);
 }
 
 void
@@ -21,75 +22,25 @@ EagerWorker::StartWorking() {
     WorkerFunction();
 }
 
-void
-EagerWorker::Enqueue(EagerAction *txn) {
-    if (m_queue_head == NULL) {
-        assert(m_queue_tail == NULL);
-        m_queue_head = txn;
-        m_queue_tail = txn;
-        txn->prev = NULL;
-        txn->next = NULL;
-    }
-    else {
-        m_queue_tail->next = txn;
-        txn->next = NULL;
-        txn->prev = m_queue_tail;
-        m_queue_tail = txn;
-    }
-    m_num_elems += 1;
-    assert((m_queue_head == NULL && m_queue_tail == NULL) ||
-           (m_queue_head != NULL && m_queue_tail != NULL));
-}
-
-void
-EagerWorker::RemoveQueue(EagerAction *txn) {
-    EagerAction *prev = txn->prev;
-    EagerAction *next = txn->next;
-
-    if (m_queue_head == txn) {
-        assert(txn->prev == NULL);
-        m_queue_head = txn->next;
-    }
-    else {
-        prev->next = next;
-    }
-    
-    if (m_queue_tail == txn) {
-        assert(txn->next == NULL);
-        m_queue_tail = txn->prev;
-    }
-    else {
-        next->prev = prev;
-    }
-    
-    m_num_elems -= 1;
-    assert(m_num_elems >= 0);
-    assert((m_queue_head == NULL && m_queue_tail == NULL) ||
-           (m_queue_head != NULL && m_queue_tail != NULL));
-}
-
-uint32_t
-EagerWorker::QueueCount(EagerAction *iter) {
-    if (iter == NULL) {
-        return 0;
-    }
-    else {
-        return 1+QueueCount(iter->next);
-    }
-}
-
+// Run the txns the lock manager has pushed on our ready stack.
 void
 EagerWorker::CheckReady() {
-    for (EagerAction *iter = m_queue_head; iter != NULL; iter = iter->next) {
-        if (iter->num_dependencies == 0) {
-            RemoveQueue(iter);
-            DoExec(iter);
-        }
+    if (m_ready == 0) {
+        return;
+    }
+    EagerAction *iter = (EagerAction*)xchgq(&m_ready, 0);
+    while (iter != NULL) {
+        EagerAction *next = iter->next;
+        m_num_elems -= 1;
+        DoExec(iter);
+        iter = next;
     }
 }
 
 void
 EagerWorker::TryExec(EagerAction *txn) {
+    txn->ready = &m_ready;
+    txn->bell = &m_bell;
     if (m_lock_mgr->Lock(txn)) {
         assert(txn->num_dependencies == 0);
         txn->Execute();
@@ -111,7 +62,7 @@ EagerWorker::TryExec(EagerAction *txn) {
     }    
     else {
         m_num_done += 1;
-        Enqueue(txn);
+        m_num_elems += 1;
     }
 }
 
@@ -138,13 +89,40 @@ void
 EagerWorker::WorkerFunction() {
     EagerAction *txn;
     uint32_t i = 0;
+    uint64_t spins = 0;
 
     while (true) {        
+        bool idle = (m_ready == 0);
         CheckReady();
         if (m_num_elems < 10 && m_txn_input_queue->Dequeue((uint64_t*)&txn)) {
             clock_gettime(CLOCK_REALTIME, &txn->start_time);
             //            txn->start_rdtsc_time = rdtsc();
             TryExec(txn);
+            idle = false;
+        }
+        if (!idle) {
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            Sleep();
         }
     }
 }
+
+bool
+EagerWorker::HasWork() {
+    return m_ready != 0 || 
+        (m_num_elems < 10 && !m_txn_input_queue->isEmpty());
+}
+
+// Sleep until we get a new txn or the lock manager grants a waiting one.
+void
+EagerWorker::Sleep() {
+    uint32_t seq = m_bell.Prepare();
+    if (HasWork()) {
+        m_bell.Cancel();
+    }
+    else {
+        m_bell.Wait(seq);
+    }
+}
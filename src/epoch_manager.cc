@@ -0,0 +1,103 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+// 
+
+#include <epoch_manager.hh>
+#include <cassert>
+
+// Attempt to advance the global epoch every so many critical sections.
+#define 	ADVANCE_PERIOD 		64
+
+volatile uint64_t EpochManager::s_global_epoch = 0;
+volatile uint64_t EpochManager::s_num_threads = 0;
+
+// Never freed, threads may still be running when static destructors run.
+EpochManager::ThreadState *EpochManager::s_threads = 
+    new EpochManager::ThreadState[MAX_EPOCH_THREADS];
+__thread EpochManager::ThreadState *EpochManager::t_state = NULL;
+
+void
+EpochManager::Register() {
+    assert(t_state == NULL);
+    uint64_t index = fetch_and_increment(&s_num_threads) - 1;
+    assert(index < MAX_EPOCH_THREADS);
+    t_state = &s_threads[index];
+    t_state->epoch = s_global_epoch;
+    t_state->active = 0;
+    t_state->num_enters = 0;
+}
+
+void
+EpochManager::Enter() {
+    ThreadState *me = t_state;
+    assert(me != NULL);
+    uint64_t global = s_global_epoch;
+    bool changed = global != me->epoch;
+    
+    // xchgq orders the announcement before any of our subsequent loads.
+    me->epoch = global;
+    xchgq(&me->active, 1);
+    
+    // Anything in this slot was retired at least three epochs ago. 
+    if (changed) {
+        FreeLimbo(&me->limbo[global % 3]);
+    }
+    if (++me->num_enters % ADVANCE_PERIOD == 0) {
+        TryAdvance();
+    }
+}
+
+void
+EpochManager::Exit() {
+    ThreadState *me = t_state;
+    xchgq(&me->active, 0);
+}
+
+void
+EpochManager::Retire(Action *action) {
+    ThreadState *me = t_state;
+    assert(me != NULL);
+    me->limbo[me->epoch % 3].push_back(action);
+}
+
+// The global epoch can move forward once every thread inside a critical 
+// section has seen its current value.
+void
+EpochManager::TryAdvance() {
+    uint64_t global = s_global_epoch;
+    uint64_t num_threads = s_num_threads;
+    for (uint64_t i = 0; i < num_threads; ++i) {
+        if (s_threads[i].active && s_threads[i].epoch != global) {
+            return;
+        }
+    }
+    cmp_and_swap(&s_global_epoch, global, global+1);
+}
+
+void
+EpochManager::FreeLimbo(std::vector<Action*> *limbo) {
+    std::vector<Action*> to_free;
+    to_free.swap(*limbo);
+    for (size_t i = 0; i < to_free.size(); ++i) {
+        Action *action = to_free[i];
+        for (size_t j = 0; j < action->readset.size(); ++j) {
+            Action *dep = action->readset[j].Dependency();
+            if (dep != NULL) {
+                cut_edge(&action->readset[j], dep);
+            }
+        }
+        for (size_t j = 0; j < action->writeset.size(); ++j) {
+            Action *dep = action->writeset[j].Dependency();
+            if (dep != NULL) {
+                cut_edge(&action->writeset[j], dep);
+            }
+        }
+        PoolBase *pool = action->pool;
+        if (pool == NULL) {
+            delete action;
+        }
+        else {
+            action->~Action();
+            pool->Return(action);
+        }
+    }
+}
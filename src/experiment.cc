@@ -17,13 +17,23 @@ Experiment::InitQueues(int num_queues, uint32_t size) {
     SimpleQueue **input_queues = new SimpleQueue*[m_info->num_workers];
     assert(input_queues != NULL);
     for (int i = 0; i < m_info->num_workers; ++i) {
-        char *raw_queue_data = (char*)malloc(CACHE_LINE*size);
+        char *raw_queue_data = (char*)malloc(sizeof(uint64_t)*size);
         input_queues[i] = new SimpleQueue(raw_queue_data, size);
         assert(input_queues[i] != NULL);
     }
     return input_queues;
 }
 
+// Queues that num_producers client threads can all submit to.
+SubmitQueue**
+Experiment::InitSubmitQueues(int num_queues, int num_producers, uint32_t size) {
+    SubmitQueue **ret = new SubmitQueue*[num_queues];
+    for (int i = 0; i < num_queues; ++i) {
+        ret[i] = new SubmitQueue(num_producers, size);
+    }
+    return ret;
+}
+
 timespec
 Experiment::diff_time(timespec end, timespec start) {
     timespec temp;
@@ -1,12 +1,31 @@
 #include <lazy_experiment.hh>
 
+// Max number of generated txns waiting for the scheduler in streaming runs.
+#define STREAM_WINDOW (1<<12)
+
+// Max number of finished txns the client takes from a worker at a time.
+#define STREAM_DRAIN (1<<8)
+
+// Max number of sticky txns waiting for idle workers.
+#define STICKY_LOG (1<<16)
+
 LazyExperiment::LazyExperiment(ExperimentInfo *info)
     : Experiment(info) { 
+    m_controller = NULL;
+    m_actions = NULL;
+    m_gen = NULL;
+    m_latencies = NULL;
+    m_num_latencies = 0;
+    m_clients = NULL;
 }
 
 uint32_t
-LazyExperiment::InitInputs(SimpleQueue *input_queue, int num_inputs, 
+LazyExperiment::InitInputs(SubmitQueue *input_queue, int num_inputs, 
                            WorkloadGenerator *gen) {
+    if (m_info->streaming) {
+        m_gen = gen;
+        return 0;
+    }
     uint32_t num_waits = 0;
     m_actions = (Action**)malloc(sizeof(Action*)*num_inputs);
     timespec zero_time;
@@ -28,19 +47,41 @@ LazyExperiment::InitInputs(SimpleQueue *input_queue, int num_inputs,
         m_actions[i]->end_time = zero_time;
         m_actions[i]->start_rdtsc_time = 0;
         m_actions[i]->end_rdtsc_time = 0;
-        input_queue->EnqueueBlocking((uint64_t)txn);
+        int client = i % input_queue->NumProducers();
+        input_queue->Producer(client)->EnqueueBlocking((uint64_t)txn);
     }
     return num_waits;
 }
 
+// A generator for a throughput or blind run. Every streaming client gets its
+// own, generators aren't thread safe. 
+WorkloadGenerator*
+LazyExperiment::NewGenerator() {
+    if (m_info->experiment == BLIND) {
+        return new ShoppingCart(2000, 100000, 20, m_info->blind_write_frequency,
+                                0);
+    }
+    assert(m_info->experiment == THROUGHPUT);
+    if (m_info->is_normal) {
+        return new NormalGenerator(m_info->read_set_size, 
+                                   m_info->write_set_size, m_info->num_records, 
+                                   m_info->substantiate_period, 
+                                   m_info->std_dev);
+    }
+    else {
+        return new UniformGenerator(m_info->read_set_size, 
+                                    m_info->write_set_size, m_info->num_records,
+                                    m_info->substantiate_period);
+    }
+}
+
 void
 LazyExperiment::RunThroughput() {
     TableInit table_init_params[1];
     table_init_params[0].m_table_type = ONE_DIM_TABLE;
     table_init_params[0].m_params.m_one_params.m_dim1 = m_info->num_records;
 
-    SimpleQueue **input_queue = InitQueues(1, LARGE_QUEUE);
-    m_input_queue = input_queue[0];
+    m_input_queue = new SubmitQueue(m_info->num_clients, LARGE_QUEUE);
     
     SimpleQueue **worker_inputs = InitQueues(m_info->num_workers, LARGE_QUEUE);
     SimpleQueue **worker_outputs = InitQueues(m_info->num_workers, LARGE_QUEUE);
@@ -55,20 +96,10 @@ LazyExperiment::RunThroughput() {
     m_scheduler =  new LazyScheduler(m_input_queue, feedbacks, worker_inputs, 
                                      (uint32_t)m_info->num_workers, 0, 
                                      table_init_params, 1,
-                                     (uint32_t)m_info->substantiate_threshold);
-    
-    WorkloadGenerator *gen = NULL;
-    if (m_info->is_normal) {
-        gen = new NormalGenerator(m_info->read_set_size, 
-                                  m_info->write_set_size, m_info->num_records, 
-                                  m_info->substantiate_period, m_info->std_dev);
-    }
-    else {
-        gen = new UniformGenerator(m_info->read_set_size, 
-                                   m_info->write_set_size, m_info->num_records, 
-                                   m_info->substantiate_period);
-    }
+                                     (uint32_t)m_info->substantiate_threshold,
+                                     SchedulerConfig());
     
+    WorkloadGenerator *gen = NewGenerator();
     uint32_t num_waits = InitInputs(m_input_queue, m_info->num_txns, gen);
     DoThroughputExperiment(m_info->num_workers, num_waits);
     WriteLatencies();
@@ -115,8 +146,7 @@ LazyExperiment::RunBlind() {
     table_init_params[1].m_table_type = ONE_DIM_TABLE;
     table_init_params[1].m_params.m_one_params.m_dim1 = 100000;
 
-    SimpleQueue **input_queue = InitQueues(1, LARGE_QUEUE);
-    m_input_queue = input_queue[0];
+    m_input_queue = new SubmitQueue(m_info->num_clients, LARGE_QUEUE);
     
     SimpleQueue **worker_inputs = InitQueues(m_info->num_workers, LARGE_QUEUE);
     SimpleQueue **worker_outputs = InitQueues(m_info->num_workers, LARGE_QUEUE);
@@ -131,9 +161,10 @@ LazyExperiment::RunBlind() {
     m_scheduler =  new LazyScheduler(m_input_queue, feedbacks, worker_inputs, 
                                      (uint32_t)m_info->num_workers, 0, 
                                      table_init_params, 2,
-                                     (uint32_t)m_info->substantiate_threshold);
+                                     (uint32_t)m_info->substantiate_threshold,
+                                     SchedulerConfig());
 
-    WorkloadGenerator *gen = new ShoppingCart(2000, 100000, 20, m_info->blind_write_frequency, 0);
+    WorkloadGenerator *gen = NewGenerator();
     uint32_t num_waits = InitInputs(m_input_queue, m_info->num_txns, gen);
     DoThroughputExperiment(m_info->num_workers, num_waits);
     WriteLatencies();
@@ -222,19 +253,58 @@ LazyExperiment::RunTPCC() {
     WriteNewOrderCDF();
 }
 
+// Let the workers steal from each other, if asked to.
+void
+LazyExperiment::ConnectWorkers() {
+    if (!m_info->work_stealing && m_info->parallel_width == 1) {
+        return;
+    }
+    for (int i = 0; i < m_info->num_workers; ++i) {
+        m_workers[i]->SetPeers(m_workers, m_info->num_workers, i, 
+                               m_info->work_stealing);
+        m_workers[i]->SetParallelWidth(m_info->parallel_width);
+    }
+}
+
+// Park until some worker's output queue is non-empty. 
+void
+LazyExperiment::WaitOutput(int num_workers) {
+    uint32_t seq = m_bell.Prepare();
+    for (int i = 0; i < num_workers; ++i) {
+        if (!m_output_queues[i]->isEmpty()) {
+            m_bell.Cancel();
+            return;
+        }
+    }
+    m_bell.Wait(seq);
+}
+
 void
 LazyExperiment::DoThroughputExperiment(int num_workers, uint32_t num_waits) {
+    // The output queues wake us up if we park waiting on them. 
+    for (int i = 0; i < num_workers; ++i) {
+        m_output_queues[i]->SetConsumer(&m_bell);
+    }
+
     // Start the workers and the scheduler
+    ConnectWorkers();
     for (int i = 0; i < m_info->num_workers; ++i) {
+        m_workers[i]->SetReclaim(m_info->streaming);
         m_workers[i]->Run();
     }
     
     m_scheduler->Run();
 
     pin_thread(m_info->num_workers+1);
+    EpochManager::Register();
 
+    // Our cpu time stops counting while we're parked.
+    clockid_t clock = CLOCK_THREAD_CPUTIME_ID;
+    if (Doorbell::s_spin_limit != 0) {
+        clock = CLOCK_MONOTONIC;
+    }
     timespec start_time, end_time;
-    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start_time);
+    clock_gettime(clock, &start_time);
 
     // Wait for the exeriment to complete
     uint32_t num_done = 0;
@@ -248,30 +318,241 @@ LazyExperiment::DoThroughputExperiment(int num_workers, uint32_t num_waits) {
     */
 
 
+    if (m_info->streaming) {
+        num_done = StreamInputs(num_workers);
+    }
+    uint64_t spins = 0;
     while (num_waits_done < num_waits) {
+        bool idle = true;
         for (int i = 0; i < num_workers; ++i) {
             Action *dummy;
             while (m_output_queues[i]->Dequeue((uint64_t*)&dummy)) {
+                idle = false;
                 num_done += 1;
                 if (dummy->materialize) {
                     num_waits_done += 1;
                 }
             }
         }
+        if (!idle) {
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            WaitOutput(num_workers);
+        }
     }
 
-    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end_time);
+    clock_gettime(clock, &end_time);
     if (num_done < num_waits_done) {
         std::cout << num_done << " " << num_waits_done << "\n";
     }
     assert(num_done >= num_waits_done);
     timespec diff = diff_time(end_time, start_time);
     WriteThroughput(diff, num_done);
+    
+    uint64_t cas_failures = 0, max_depth = 0, steals = 0, nodes = 0;
+    uint64_t helped = 0, background = 0;
+    for (int i = 0; i < num_workers; ++i) {
+        nodes = std::max(nodes, m_workers[i]->NodesHighWater());
+        cas_failures += m_workers[i]->NumCasFailures();
+        steals += m_workers[i]->NumSteals();
+        helped += m_workers[i]->NumHelped();
+        background += m_workers[i]->NumBackground();
+        max_depth = std::max(max_depth, m_workers[i]->MaxDepth());
+    }
+    std::cout << "CAS failures: " << cas_failures << "\n";
+    std::cout << "Max substantiation depth: " << max_depth << "\n";
+    std::cout << "Wait list high water: " << nodes << "\n";
+    if (m_info->work_stealing) {
+        std::cout << "Steals: " << steals << "\n";
+    }
+    if (m_info->parallel_width > 1) {
+        std::cout << "Chains helped: " << helped << "\n";
+    }
+    if (m_info->idle_budget > 0) {
+        std::cout << "Background substantiations: " << background << "\n";
+    }
+    std::cout << "Overflowed: " << m_scheduler->NumOverflowed() << " ";
+    std::cout << "Input stalls: " << m_scheduler->NumStalls() << "\n";
+    if (m_controller != NULL) {
+        std::cout << "Threshold: " << m_controller->Threshold() << " (";
+        std::cout << m_controller->NumIncreases() << " increases, ";
+        std::cout << m_controller->NumDecreases() << " decreases)\n";
+    }
     std::cout << num_done << " " << diff.tv_sec << "." << diff.tv_nsec << "\n";
 }
 
+// Generate txns while the experiment runs, keeping at most STREAM_WINDOW of 
+// them in the input queue. Txns are released as they come out of the 
+// workers, and the latencies of materialized txns are recorded then.
+uint32_t
+LazyExperiment::StreamInputs(int num_workers) {
+    int num_txns = m_info->num_txns;
+    int num_generated = 0;
+    uint32_t num_waits = 0, num_waits_done = 0, num_done = 0;
+    timespec zero_time;
+    zero_time.tv_sec = 0;
+    zero_time.tv_nsec = 0;
+    m_latencies = (double*)malloc(sizeof(double)*num_txns);
+    m_num_latencies = 0;
+
+    // With more than one client, we only take txns out of the workers. 
+    SimpleQueue *input_queue = m_input_queue->Producer(0);
+    bool generating = true;
+    if (m_info->num_clients > 1) {
+        StartClients();
+    }
+
+    Action *next = NULL;
+    while (generating || num_waits_done < num_waits) {
+        if (m_clients != NULL) {
+            generating = !ClientsDone(&num_waits);
+        }
+        while (m_clients == NULL && num_generated < num_txns && 
+               input_queue->Size() < STREAM_WINDOW) {
+            if (next == NULL) {
+                next = m_gen->genNext();
+                if (m_info->experiment == BLIND && 
+                    num_generated >= num_txns - m_info->num_workers - 1) {
+                    next->materialize = true;
+                }
+                next->start_time = zero_time;
+                next->end_time = zero_time;
+            }
+            if (!input_queue->Enqueue((uint64_t)next)) {
+                break;
+            }
+            num_waits += next->materialize? 1 : 0;
+            num_generated += 1;
+            next = NULL;
+        }
+        if (m_clients == NULL) {
+            generating = num_generated < num_txns;
+        }
+        
+        // Keep critical sections short, freed txns are only reclaimed when 
+        // we next enter one. 
+        EpochManager::Enter();
+        for (int i = 0; i < num_workers; ++i) {
+            Action *batch[STREAM_DRAIN];
+            uint32_t num = m_output_queues[i]->DequeueBatch((uint64_t*)batch, 
+                                                            STREAM_DRAIN);
+            for (uint32_t j = 0; j < num; ++j) {
+                Action *done = batch[j];
+                num_done += 1;
+                if (done->materialize) {
+                    num_waits_done += 1;
+                    timespec diff = diff_time(done->end_time, done->start_time);
+                    if (diff.tv_sec >= 0 && diff.tv_nsec >= 0 && 
+                        (done->start_time.tv_sec != 0 || 
+                         done->start_time.tv_nsec != 0)) {
+                        m_latencies[m_num_latencies++] = 
+                            (1000000.0*diff.tv_sec) + (diff.tv_nsec/1000.0);
+                    }
+                }
+                action_release(done);
+            }
+        }
+        EpochManager::Exit();
+    }
+    for (int i = 0; m_clients != NULL && i < m_info->num_clients; ++i) {
+        pthread_join(m_clients[i].thread, NULL);
+    }
+    return num_done;
+}
+
+// Split the run's txns between num_clients threads that generate and submit
+// them concurrently, each through its own ring and with its own share of the
+// window. Clients go on the cpus after the scheduler's extra threads.
+void
+LazyExperiment::StartClients() {
+    int num_clients = m_info->num_clients;
+    int first_cpu = m_info->num_workers + 2;
+    if (m_info->sched_partitions > 1) {
+        first_cpu += m_info->sched_partitions;
+    }
+    else if (m_info->sched_pipeline) {
+        first_cpu += 1;
+    }
+    m_clients = new StreamClient[num_clients];
+    for (int i = 0; i < num_clients; ++i) {
+        StreamClient *client = &m_clients[i];
+        client->gen = i == 0? m_gen : NewGenerator();
+        client->ring = m_input_queue->Producer(i);
+        client->ring->SetProducer(&client->bell);
+        client->num_txns = m_info->num_txns / num_clients + 
+            (i < m_info->num_txns % num_clients? 1 : 0);
+        client->num_blind = m_info->experiment == BLIND? 
+            m_info->num_workers + 1 : 0;
+        client->window = std::max(STREAM_WINDOW / num_clients, 1);
+        client->cpu = first_cpu + i;
+        client->num_waits = 0;
+        client->done = 0;
+        pthread_create(&client->thread, NULL, RunClient, client);
+    }
+}
+
+// Returns true once every client has submitted all its txns, and sets 
+// num_waits to the number of materialized txns among them. 
+bool
+LazyExperiment::ClientsDone(uint32_t *num_waits) {
+    uint32_t waits = 0;
+    for (int i = 0; i < m_info->num_clients; ++i) {
+        if (!m_clients[i].done) {
+            return false;
+        }
+        waits += m_clients[i].num_waits;
+    }
+    *num_waits = waits;
+    return true;
+}
+
+void*
+LazyExperiment::RunClient(void *arg) {
+    StreamClient *client = (StreamClient*)arg;
+    pin_thread(client->cpu);
+    timespec zero_time;
+    zero_time.tv_sec = 0;
+    zero_time.tv_nsec = 0;
+
+    uint64_t num_waits = 0;
+    for (int i = 0; i < client->num_txns; ++i) {
+        Action *txn = client->gen->genNext();
+        if (i >= client->num_txns - client->num_blind) {
+            txn->materialize = true;
+        }
+        txn->start_time = zero_time;
+        txn->end_time = zero_time;
+        num_waits += txn->materialize? 1 : 0;
+
+        // Wait for room in our share of the window.
+        uint64_t spins = 0;
+        while (client->ring->Size() >= client->window) {
+            if (!Doorbell::Spin(&spins)) {
+                do_pause();
+                continue;
+            }
+            uint32_t seq = client->bell.Prepare();
+            if (client->ring->Size() < client->window) {
+                client->bell.Cancel();
+            }
+            else {
+                client->bell.Wait(seq);
+            }
+        }
+        client->ring->EnqueueBlocking((uint64_t)txn);
+    }
+    client->num_waits = num_waits;
+    client->done = 1;
+    return NULL;
+}
+
 void
 LazyExperiment::WriteLatencies() {
+    if (m_info->streaming) {
+        WriteCDF(m_latencies, m_num_latencies);
+        return;
+    }
     double *times = (double*)malloc(sizeof(double)*m_info->num_txns);
     int count = 0;
     for (int i = 0; i < m_info->num_txns; ++i) {
@@ -327,15 +608,44 @@ LazyExperiment::InitializeTPCC() {
     TableInit *table_init_params = InitializeTPCCParams();    
     
     // Initialize the scheduler input queue
-    SimpleQueue **input_queue = InitQueues(1, LARGE_QUEUE);
-    m_input_queue = input_queue[0];
-    assert(m_input_queue != NULL);
+    m_input_queue = new SubmitQueue(m_info->num_clients, LARGE_QUEUE);
     
     // Initialize the scheduler
     m_scheduler =  new LazyScheduler(m_input_queue, feedback, worker_inputs, 
                                      (uint32_t)m_info->num_workers, 0, 
                                      table_init_params, s_num_tables, 
-                                     (uint32_t)m_info->substantiate_threshold);
+                                     (uint32_t)m_info->substantiate_threshold,
+                                     SchedulerConfig());
+}
+
+// The scheduler's extra threads, if any, go on the cpus after the client 
+// thread.
+LazySchedulerConfig
+LazyExperiment::SchedulerConfig() {
+    LazySchedulerConfig config;
+    config.num_partitions = m_info->sched_partitions;
+    config.partition_cpu = m_info->num_workers+2;
+    config.pipeline = m_info->sched_pipeline;
+    config.pipeline_cpu = m_info->num_workers+2;
+    config.batch_size = m_info->sched_batch;
+    config.routing = (RoutingPolicy)m_info->routing;
+    config.reclaim = m_info->streaming;
+    if (m_info->latency_target > 0) {
+        assert(m_controller == NULL);
+        m_controller = 
+            new ThresholdController(m_workers, m_info->num_workers, 
+                                    m_info->substantiate_threshold,
+                                    (uint64_t)m_info->latency_target);
+        config.controller = m_controller;
+    }
+    if (m_info->idle_budget > 0) {
+        config.sticky_log = new WorkStealingDeque(STICKY_LOG);
+        for (int i = 0; i < m_info->num_workers; ++i) {
+            m_workers[i]->SetStickyLog(config.sticky_log, 
+                                       (uint64_t)m_info->idle_budget);
+        }
+    }
+    return config;
 }
 
 uint32_t 
@@ -380,14 +690,15 @@ LazyExperiment::RunPeak() {
                                       i+1);
     }
 
-    SimpleQueue **sched_input = InitQueues(1, SMALL_QUEUE);
-    m_scheduler =  new LazyScheduler(sched_input[0], feedbacks, worker_inputs, 
+    SubmitQueue *sched_input = new SubmitQueue(1, SMALL_QUEUE);
+    m_scheduler =  new LazyScheduler(sched_input, feedbacks, worker_inputs, 
                                      (uint32_t)m_info->num_workers, 0, 
                                      table_init_params, 1,
-                                     (uint32_t)m_info->substantiate_threshold);
+                                     (uint32_t)m_info->substantiate_threshold,
+                                     SchedulerConfig());
 
     // Do the experiment
-    WaitPeak(180, input_actions, sched_input[0]);
+    WaitPeak(180, input_actions, sched_input->Producer(0));
 }
 
 void
@@ -402,6 +713,7 @@ LazyExperiment::WaitPeak(uint32_t duration,
     }
 
     m_scheduler->Run();
+    ConnectWorkers();
     for (int i = 0; i < m_info->num_workers; ++i) {
         m_workers[i]->Run();
     }
@@ -574,6 +886,9 @@ LazyExperiment::WaitPeak(uint32_t duration,
         cur += diff;
     }
     throughput_file.close();
+    
+    std::cout << "Overflowed: " << m_scheduler->NumOverflowed() << " ";
+    std::cout << "Input stalls: " << m_scheduler->NumStalls() << "\n";
 }
 
 TableInit*
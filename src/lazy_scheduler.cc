@@ -13,17 +13,41 @@
 using namespace tpcc;
 using namespace std;
 
-LazyScheduler::LazyScheduler(SimpleQueue *input_queue, 
+// Capacity of the queues between the sequencer and the partitions.
+#define PARTITION_QUEUE (1<<16)
+
+// Capacity of the queue between the two stages of the pipeline.
+#define PIPELINE_QUEUE (1<<16)
+
+// Most txns taken off a feedback queue at once.
+#define FEEDBACK_BATCH 32
+
+LazyScheduler::LazyScheduler(SubmitQueue *input_queue, 
                              SimpleQueue **feedback_queues, 
                              SimpleQueue **worker_queues, int num_workers, 
                              int cpu_number, cc_params::TableInit *params, 
-                             int num_params, int max_chain)
+                             int num_params, int max_chain, 
+                             LazySchedulerConfig config)
     : Runnable(cpu_number) {
-    m_tables = do_tbl_init<Heuristic>(params, num_params);
-    assert(m_tables != NULL);
+    m_max_chain = max_chain;
+    m_num_partitions = config.num_partitions;
+    m_partitions = NULL;
+    m_partition_queues = NULL;
+    m_ready_queues = NULL;
+    m_next_seq = 1;
+    m_tables = NULL;
+    if (m_num_partitions > 1) {
+        InitPartitions(config, params, num_params);
+    }
+    else {
+        m_tables = do_tbl_init<Heuristic>(params, num_params);
+        assert(m_tables != NULL);
+    }
     
     m_max_chain = max_chain;
     m_last_used = 0;
+    m_routing = config.routing;
+    m_controller = config.controller;
     
     m_num_stickified = 0;
     m_num_workers = num_workers;
@@ -31,43 +55,118 @@ LazyScheduler::LazyScheduler(SimpleQueue *input_queue,
     m_feedback_queues = feedback_queues;
     m_worker_queues = worker_queues;
 
-    m_materialize_counter = 0;
-    m_materialize_on = true;
+    m_overflow = new deque<Action*>[m_num_workers];
+    m_overflow_cap = config.overflow_cap;
+    m_sticky_log = config.sticky_log;
+    m_reclaim = config.reclaim;
+    assert(m_sticky_log == NULL || m_num_partitions == 1);
+    m_num_overflowed = 0;
+    m_num_stalls = 0;
     m_dummy = 0;
     assert(m_input_queue != NULL);
     //    assert(m_feedback_queues != NULL);
     assert(m_worker_queues != NULL);
     
-    /*
+    m_batch_size = config.batch_size;
+    assert(m_batch_size >= 1);
+    m_batch.reserve(m_batch_size);
+    m_inputs = (Action**)malloc(sizeof(Action*)*m_batch_size);
+    assert(m_inputs != NULL);
+    m_pipeline = config.pipeline;
+    m_pipeline_cpu = config.pipeline_cpu;
+    m_internal_queue = NULL;
     m_internal_flag = 0;
-    char *internal_queue_data = (char *)malloc(CACHE_LINE*LARGE_QUEUE);
-    memset(internal_queue_data, 0, CACHE_LINE*LARGE_QUEUE);
-    m_internal_queue = new SimpleQueue(internal_queue_data, LARGE_QUEUE);
+    if (m_pipeline) {
+        assert(m_num_partitions == 1);
+        assert(m_pipeline_cpu >= 0);
+        char *internal_queue_data = (char *)malloc(sizeof(uint64_t)*PIPELINE_QUEUE);
+        memset(internal_queue_data, 0, sizeof(uint64_t)*PIPELINE_QUEUE);
+        m_internal_queue = new SimpleQueue(internal_queue_data, PIPELINE_QUEUE);
+    }
+}
 
-    pthread_create(&m_pipeline_thread, NULL, Pipeline, this);
-    while (!m_internal_flag)
-      ;
-    */
+void
+LazyScheduler::InitPartitions(const LazySchedulerConfig &config, 
+                              cc_params::TableInit *params, int num_params) {
+    assert(m_num_partitions <= 64);
+    assert(config.partition_cpu >= 0);
+    
+    m_partition_queues = 
+        (SimpleQueue**)malloc(sizeof(SimpleQueue*)*m_num_partitions);
+    m_ready_queues = 
+        (SimpleQueue**)malloc(sizeof(SimpleQueue*)*m_num_partitions);
+    m_partitions = (SchedulerPartition**)
+        malloc(sizeof(SchedulerPartition*)*m_num_partitions);
+    for (int i = 0; i < m_num_partitions; ++i) {
+        char *data = (char*)malloc(sizeof(uint64_t)*PARTITION_QUEUE);
+        memset(data, 0, sizeof(uint64_t)*PARTITION_QUEUE);
+        m_partition_queues[i] = new SimpleQueue(data, PARTITION_QUEUE);
+        
+        data = (char*)malloc(sizeof(uint64_t)*PARTITION_QUEUE);
+        memset(data, 0, sizeof(uint64_t)*PARTITION_QUEUE);
+        m_ready_queues[i] = new SimpleQueue(data, PARTITION_QUEUE);
+        
+        m_partitions[i] = new SchedulerPartition(m_partition_queues[i], 
+                                                 m_ready_queues[i], i, 
+                                                 m_num_partitions, 
+                                                 config.partition_cpu+i,
+                                                 params, num_params, 
+                                                 m_max_chain, config.reclaim);
+    }
 }
 
 void
 LazyScheduler::StartWorking() {
 
     Action *txn;
+    Action *feedback[FEEDBACK_BATCH];
     assert(m_input_queue != NULL);
+    if (m_num_partitions > 1) {
+        PartitionedWorking();
+        return;
+    }
+    if (m_pipeline) {
+        PipelinedWorking();
+        return;
+    }
+    m_input_queue->SetConsumer(&m_bell);
+    for (int i = 0; i < m_num_workers; ++i) {
+        m_feedback_queues[i]->SetConsumer(&m_bell);
+    }
+    uint64_t spins = 0;
+    EpochManager::Register();
     while (true) {        
+        EpochManager::Enter();
+        PollController();
+        DrainOverflow();
+
         // Check if any of the workers need to continue a txn
         for (int i = 0; i < m_num_workers; ++i) {
-            while (m_feedback_queues[i]->Dequeue((uint64_t*)&txn)) {
-                if (txn->NowPhase()) {
-                    AddGraph(txn);         
-                 
+            uint32_t num;
+            while ((num = m_feedback_queues[i]->DequeueBatch((uint64_t*)feedback, 
+                                                             FEEDBACK_BATCH)) != 0) {
+                for (uint32_t j = 0; j < num; ++j) {
+                    if (feedback[j]->NowPhase()) {
+                        AddGraph(feedback[j]);
+                    }
                 }
             }
         }
 
         // Check if there's any input
-        if (m_input_queue->Dequeue((uint64_t*)&txn)) {
+        bool overloaded = Overloaded();
+        if (!overloaded && m_batch_size > 1) {
+            uint32_t num = m_input_queue->DequeueBatch((uint64_t*)m_inputs, 
+                                                       m_batch_size);
+            m_num_stickified += num;
+            for (uint32_t i = 0; i < num; ++i) {
+                if (m_inputs[i]->NowPhase()) {
+                    m_batch.push_back(m_inputs[i]);
+                }
+            }
+            AddGraphBatch();
+        }
+        else if (!overloaded && m_input_queue->Dequeue((uint64_t*)&txn)) {
             //            txn->start_rdtsc_time = rdtsc();
             m_num_stickified += 1;
             if (txn->NowPhase()) {
@@ -77,38 +176,207 @@ LazyScheduler::StartWorking() {
             }
             //            txn->end_rdtsc_time = rdtsc();
         }        
+        EpochManager::Exit();
+        if (Doorbell::s_spin_limit != 0 && !HasOverflow()) {
+            Idle(&spins);
+        }
+    }
+}
+
+// Park the calling thread if it has been out of input for long enough. 
+void
+LazyScheduler::Idle(uint64_t *spins) {
+    if (HasInput()) {
+        *spins = 0;
+    }
+    else if (Doorbell::Spin(spins)) {
+        uint32_t seq = m_bell.Prepare();
+        if (HasInput()) {
+            m_bell.Cancel();
+        }
+        else {
+            m_bell.Wait(seq);
+        }
+    }
+}
+
+bool
+LazyScheduler::HasInput() {
+    if (!m_input_queue->isEmpty()) {
+        return true;
+    }
+    for (int i = 0; i < m_num_workers; ++i) {
+        if (!m_feedback_queues[i]->isEmpty()) {
+            return true;
+        }
+    }
+    for (int i = 0; i < m_num_partitions && m_ready_queues != NULL; ++i) {
+        if (!m_ready_queues[i]->isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// First stage of the pipelined scheduler. Runs the now phase of inputs and 
+// continuations in serial order, and leaves graph insertion to the second 
+// stage.
+void
+LazyScheduler::PipelinedWorking() {
+    Action *txn;
+    Action *feedback[FEEDBACK_BATCH];
+    m_input_queue->SetConsumer(&m_bell);
+    for (int i = 0; i < m_num_workers; ++i) {
+        m_feedback_queues[i]->SetConsumer(&m_bell);
+    }
+    m_internal_queue->SetProducer(&m_bell);
+    m_internal_queue->SetConsumer(&m_graph_bell);
+    pthread_create(&m_pipeline_thread, NULL, Pipeline, this);
+    uint64_t spins = 0;
+    while (!m_internal_flag) {
+        if (Doorbell::Spin(&spins)) {
+            uint32_t seq = m_bell.Prepare();
+            if (m_internal_flag) {
+                m_bell.Cancel();
+            }
+            else {
+                m_bell.Wait(seq);
+            }
+        }
+    }
+    
+    spins = 0;
+    while (true) {
+        if (Doorbell::s_spin_limit != 0) {
+            Idle(&spins);
+        }
+        PollController();
+        for (int i = 0; i < m_num_workers; ++i) {
+            uint32_t num;
+            while ((num = m_feedback_queues[i]->DequeueBatch((uint64_t*)feedback, 
+                                                             FEEDBACK_BATCH)) != 0) {
+                for (uint32_t j = 0; j < num; ++j) {
+                    if (feedback[j]->NowPhase()) {
+                        m_internal_queue->EnqueueBlocking((uint64_t)feedback[j]);
+                    }
+                }
+            }
+        }
+        
+        if (m_input_queue->Dequeue((uint64_t*)&txn)) {
+            m_num_stickified += 1;
+            if (txn->NowPhase()) {
+                m_internal_queue->EnqueueBlocking((uint64_t)txn);
+            }
+        }
     }
 }
 
-/*
+// Second stage of the pipelined scheduler, adds actions to the dependency 
+// graph and hands them to the workers.
 void*
 LazyScheduler::Pipeline(void *arg) {
     LazyScheduler *me = (LazyScheduler*)arg;
     
     // Pin the thread to a cpu
-    if (pin_thread(1) == -1) {
+    if (pin_thread(me->m_pipeline_cpu) == -1) {
         std::cout << "Couldn't bind to a cpu!\n";
         exit(-1);
     }    
     xchgq(&me->m_internal_flag, 1);
+    me->m_bell.Ring();
     
+    uint64_t spins = 0;
+    EpochManager::Register();
     while (true) {
         Action *action;
-        action = (Action*)me->m_internal_queue->DequeueBlocking();
-        me->AddGraph(action);
+        EpochManager::Enter();
+        me->DrainOverflow();
+        if (!me->Overloaded() && 
+            me->m_internal_queue->Dequeue((uint64_t*)&action)) {
+            if (me->m_batch_size == 1) {
+                me->AddGraph(action);
+            }
+            else {
+                me->m_batch.push_back(action);
+                while ((int)me->m_batch.size() < me->m_batch_size && 
+                       me->m_internal_queue->Dequeue((uint64_t*)&action)) {
+                    me->m_batch.push_back(action);
+                }
+                me->AddGraphBatch();
+            }
+        }
+        EpochManager::Exit();
+        
+        // Park if there's nothing to add to the graph. 
+        if (!me->m_internal_queue->isEmpty() || me->HasOverflow()) {
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            uint32_t seq = me->m_graph_bell.Prepare();
+            if (!me->m_internal_queue->isEmpty()) {
+                me->m_graph_bell.Cancel();
+            }
+            else {
+                me->m_graph_bell.Wait(seq);
+            }
+        }
     }
+    return NULL;
 }
-*/
 
-// Add the given action to the dependency graph. 
-void LazyScheduler::AddGraph(Action* action) {
+// Add the actions in m_batch to the dependency graph, in order. The Heuristic 
+// slots of the whole batch are looked up and prefetched first, so the misses
+// overlap instead of stalling each update in turn.
+void
+LazyScheduler::AddGraphBatch() {
+    int num_actions = m_batch.size();
+    if (num_actions == 0) {
+        return;
+    }
+    
+    m_batch_slots.clear();
+    for (int i = 0; i < num_actions; ++i) {
+        Action *action = m_batch[i];
+        int num_reads = action->readset.size();
+        int num_writes = action->writeset.size();
+        for (int j = 0; j < num_reads; ++j) {
+            CompositeKey record = action->readset[j].record;
+            Heuristic *slot = m_tables[record.m_table]->GetPtr(record.m_key);
+            __builtin_prefetch(slot, 1, 3);
+            m_batch_slots.push_back(slot);
+        }
+        for (int j = 0; j < num_writes; ++j) {
+            CompositeKey record = action->writeset[j].record;
+            Heuristic *slot = m_tables[record.m_table]->GetPtr(record.m_key);
+            __builtin_prefetch(slot, 1, 3);
+            m_batch_slots.push_back(slot);
+        }
+    }
+    
+    int offset = 0;
+    for (int i = 0; i < num_actions; ++i) {
+        Action *action = m_batch[i];
+        AddGraph(action, &m_batch_slots[offset]);
+        offset += action->readset.size() + action->writeset.size();
+    }
+    m_batch.clear();
+}
+
+// Add the given action to the dependency graph. If slots is non-NULL, it 
+// holds the Heuristic entries of the read set followed by the write set.
+//
+// When actions are reclaimed, a Heuristic entry holds a reference on its last 
+// txn. When the entry moves on to a new action, that reference passes to the 
+// new action's DependencyInfo.
+void LazyScheduler::AddGraph(Action* action, Heuristic **slots) {
     action->state = STICKY;
         
     // Iterate through this action's read set and write set, find the 
     // transactions it depends on and add it to the dependency graph. 
     int num_reads = action->readset.size();
     int num_writes = action->writeset.size();
-    int* count_ptrs[num_reads+num_writes];
+    Heuristic* dep_ptrs[num_reads+num_writes];
     
     // Go through the read set. 
     uint32_t force_materialize = action->materialize;
@@ -116,27 +384,27 @@ void LazyScheduler::AddGraph(Action* action) {
         CompositeKey record = action->readset[i].record;
         /*
         if (record.m_table == 8) {
-            action->readset[i].dependency = NULL;
-            action->readset[i].is_write = false;
-            action->readset[i].index = -1;
+            action->readset[i].m_dep = PackedDep::EMPTY;
             count_ptrs[i] = &m_dummy;
             continue;
         }
         */
 
-        Heuristic *dep_info = m_tables[record.m_table]->GetPtr(record.m_key);
+        Heuristic *dep_info = slots != NULL? slots[i] : 
+            m_tables[record.m_table]->GetPtr(record.m_key);
 
         // Keep the information about the previous txn around.
-        action->readset[i].dependency = dep_info->last_txn;	
-        //        action->readset[i].dependency = NULL;
-        action->readset[i].is_write = dep_info->is_write;
-        action->readset[i].index = dep_info->index;
-        count_ptrs[i] = &(dep_info->chain_length);
+        action->readset[i].m_dep = dep_info->Packed();
+        dep_ptrs[i] = dep_info;
+        if (m_reclaim) {
+            try_cut(&action->readset[i], CUT_DEPTH);
+        }
             
         // Update the heuristic information. 
-        dep_info->last_txn = action;
-        dep_info->index = i;
-        dep_info->is_write = false;
+        dep_info->Update(action, i, false);
+        if (m_reclaim) {
+            action_ref(action);
+        }
             
         // Increment the length of the chain corresponding to this record, 
         // check if it exceeds our threshold value. 
@@ -149,49 +417,46 @@ void LazyScheduler::AddGraph(Action* action) {
         CompositeKey record = action->writeset[i].record;
         /*
         if (record.m_table == 8) {
-            action->writeset[i].dependency = NULL;
-            action->writeset[i].is_write = false;
-            action->writeset[i].index = -1;
+            action->writeset[i].m_dep = PackedDep::EMPTY;
             count_ptrs[num_reads+i] = &m_dummy;
             continue;
         }
         */
-        Heuristic *dep_info = m_tables[record.m_table]->GetPtr(record.m_key);
+        Heuristic *dep_info = slots != NULL? slots[num_reads+i] : 
+            m_tables[record.m_table]->GetPtr(record.m_key);
         
         // Keep the information about the previous txn around. 
-        action->writeset[i].dependency = dep_info->last_txn;
-        //        action->writeset[i].dependency = NULL;
-        action->writeset[i].is_write = dep_info->is_write;
-        action->writeset[i].index = dep_info->index;
-        count_ptrs[num_reads+i] = &(dep_info->chain_length);
+        action->writeset[i].m_dep = dep_info->Packed();
+        dep_ptrs[num_reads+i] = dep_info;
+        if (m_reclaim) {
+            try_cut(&action->writeset[i], CUT_DEPTH);
+        }
             
         // Update the heuristic information. 
-        dep_info->last_txn = action;
-        dep_info->index = i;
-        dep_info->is_write = true;
+        dep_info->Update(action, i, true);
+        if (m_reclaim) {
+            action_ref(action);
+        }
             
         // Increment the length of the chain corresponding to this record, 
         // check if it exceeds our threshold value. 
         dep_info->chain_length += 1;
         force_materialize |= (uint32_t)(dep_info->chain_length >= m_max_chain);
     }  
-    m_materialize_counter += 1;
-    m_materialize_on |= m_materialize_counter & (1<<14);
-
     if (force_materialize) {
-        int index = m_last_used % m_num_workers;
+        int index = ChooseWorker(dep_ptrs, num_reads+num_writes);
         //        clock_gettime(CLOCK_REALTIME, &action->start_time);
-        if (!m_worker_queues[index]->Enqueue((uint64_t)action)) {
-            m_materialize_counter = 0;
-            m_materialize_on = false;
-        }
-        else {
-            for (int i = 0; i < num_reads+num_writes; ++i) {
-                *(count_ptrs[i]) = 0;		  
-            }
+        action_ref(action);
+        Deliver(action, index);
+        for (int i = 0; i < num_reads+num_writes; ++i) {
+            dep_ptrs[i]->chain_length = 0;
+            dep_ptrs[i]->owner = index;
         }
         m_last_used += 1;
     }
+    else if (m_sticky_log != NULL) {
+        LogSticky(action);
+    }
     /*
     else {
         action->state = STICKY;
@@ -201,6 +466,375 @@ void LazyScheduler::AddGraph(Action* action) {
 }
 
 
+// Append a sticky action to the log, along with a reference for whoever takes
+// it off. If the log is full, the oldest entries make room. Those are the 
+// most likely to have been substantiated by now, and any that weren't are 
+// still reachable through the graph.
+void
+LazyScheduler::LogSticky(Action *action) {
+    Action *oldest;
+    action_ref(action);
+    while (!m_sticky_log->Push((uint64_t)action)) {
+        if (m_sticky_log->Steal((uint64_t*)&oldest)) {
+            action_release(oldest);
+        }
+    }
+}
+
+// The scheduler thread acts as a sequencer when the dependency graph is 
+// partitioned. It runs the now phase of every action, stamps it with its 
+// position in the serial order, and hands it to each partition that owns one 
+// of its records. Partitions hand fully processed actions back through the 
+// ready queues, and the sequencer alone routes them to the workers.
+void
+LazyScheduler::PartitionedWorking() {
+    Action *txn;
+    Action *feedback[FEEDBACK_BATCH];
+    m_input_queue->SetConsumer(&m_bell);
+    for (int i = 0; i < m_num_workers; ++i) {
+        m_feedback_queues[i]->SetConsumer(&m_bell);
+    }
+    for (int i = 0; i < m_num_partitions; ++i) {
+        m_ready_queues[i]->SetConsumer(&m_bell);
+        m_partition_queues[i]->SetProducer(&m_bell);
+        m_partitions[i]->Run();
+    }
+    
+    uint64_t spins = 0;
+    while (true) {
+        PollController();
+        for (int i = 0; i < m_num_workers; ++i) {
+            uint32_t num;
+            while ((num = m_feedback_queues[i]->DequeueBatch((uint64_t*)feedback, 
+                                                             FEEDBACK_BATCH)) != 0) {
+                for (uint32_t j = 0; j < num; ++j) {
+                    if (feedback[j]->NowPhase()) {
+                        Dispatch(feedback[j]);
+                    }
+                }
+            }
+        }
+        
+        DrainOverflow();
+        if (!Overloaded() && m_input_queue->Dequeue((uint64_t*)&txn)) {
+            m_num_stickified += 1;
+            if (txn->NowPhase()) {
+                Dispatch(txn);
+            }
+        }
+        DrainReady();
+        if (Doorbell::s_spin_limit != 0 && !HasOverflow()) {
+            Idle(&spins);
+        }
+    }
+}
+
+void
+LazyScheduler::Dispatch(Action *action) {
+    action->state = STICKY;
+    action->sched_seq = m_next_seq++;
+    action->sched_force = action->materialize? 1 : 0;
+    
+    // Find the partitions this action touches. 
+    uint64_t mask = 0;
+    int num_reads = action->readset.size();
+    int num_writes = action->writeset.size();
+    for (int i = 0; i < num_reads; ++i) {
+        mask |= 1ULL << SchedulerPartition::PartitionOf(action->readset[i].record,
+                                                        m_num_partitions);
+    }
+    for (int i = 0; i < num_writes; ++i) {
+        mask |= 1ULL << SchedulerPartition::PartitionOf(action->writeset[i].record,
+                                                        m_num_partitions);
+    }
+    action->sched_pending = __builtin_popcountll(mask);
+    if (mask == 0) {
+        if (action->sched_force) {
+            action_ref(action);
+            Route(action);
+        }
+        return;
+    }
+    
+    // Every partition sees the actions it owns in sequence order.
+    for (int i = 0; i < m_num_partitions; ++i) {
+        if (mask & (1ULL << i)) {
+            while (!m_partition_queues[i]->Enqueue((uint64_t)action)) {
+                DrainReady();
+            }
+        }
+    }
+}
+
+// Route actions that every partition is done with. 
+void
+LazyScheduler::DrainReady() {
+    Action *action;
+    for (int i = 0; i < m_num_partitions; ++i) {
+        while (m_ready_queues[i]->Dequeue((uint64_t*)&action)) {
+            Route(action);
+        }
+    }
+}
+
+// The sequencer doesn't see the Heuristic entries, which live in the 
+// partitions, so locality routing falls back to the least loaded worker.
+// Every partition has already counted the action as substantiated, so it
+// can't be dropped if the worker's queue is full.
+void
+LazyScheduler::Route(Action *action) {
+    int index = ChooseWorker(NULL, 0);
+    Deliver(action, index);
+    m_last_used += 1;
+}
+
+// Hand an action to a worker. If the worker's input queue is full, or older 
+// actions are still waiting for it, the action goes in the worker's overflow 
+// buffer. The caller must have taken a reference on the action for the 
+// worker, since another worker may substantiate it in the meantime.
+void
+LazyScheduler::Deliver(Action *action, int index) {
+    if (!m_overflow[index].empty() || 
+        !m_worker_queues[index]->Enqueue((uint64_t)action)) {
+        m_overflow[index].push_back(action);
+        m_num_overflowed += 1;
+    }
+}
+
+// Move as much of the overflow buffers into the worker queues as fits. 
+bool
+LazyScheduler::HasOverflow() {
+    for (int i = 0; i < m_num_workers; ++i) {
+        if (!m_overflow[i].empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+LazyScheduler::DrainOverflow() {
+    for (int i = 0; i < m_num_workers; ++i) {
+        while (!m_overflow[i].empty() && 
+               m_worker_queues[i]->Enqueue((uint64_t)m_overflow[i].front())) {
+            m_overflow[i].pop_front();
+        }
+    }
+}
+
+// True if some worker's overflow buffer is full. The scheduler then stops 
+// taking new input until it has drained, so the input queue fills up and 
+// clients see their enqueues fail.
+bool
+LazyScheduler::Overloaded() {
+    for (int i = 0; i < m_num_workers; ++i) {
+        if (m_overflow[i].size() >= m_overflow_cap) {
+            m_num_stalls += 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+SchedulerPartition::SchedulerPartition(SimpleQueue *input_queue, 
+                                       SimpleQueue *ready_queue, 
+                                       int partition_id, int num_partitions, 
+                                       int cpu_number, 
+                                       cc_params::TableInit *params, 
+                                       int num_params, int max_chain, 
+                                       bool reclaim) 
+    : Runnable(cpu_number) {
+    m_reclaim = reclaim;
+    m_input_queue = input_queue;
+    m_ready_queue = ready_queue;
+    m_partition_id = partition_id;
+    m_num_partitions = num_partitions;
+    m_max_chain = max_chain;
+    m_last_seq = 0;
+    m_tables = do_tbl_init<Heuristic>(params, num_params);
+    assert(m_tables != NULL);
+    m_input_queue->SetConsumer(&m_bell);
+    m_ready_queue->SetProducer(&m_bell);
+}
+
+void
+SchedulerPartition::StartWorking() {
+    Action *action;
+    uint64_t spins = 0;
+    EpochManager::Register();
+    while (true) {
+        EpochManager::Enter();
+        bool idle = !m_input_queue->Dequeue((uint64_t*)&action);
+        if (!idle) {
+            AddGraph(action);
+        }
+        EpochManager::Exit();
+        if (!idle) {
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            Sleep();
+        }
+    }
+}
+
+// Sleep until the sequencer sends an action. 
+void
+SchedulerPartition::Sleep() {
+    uint32_t seq = m_bell.Prepare();
+    if (!m_input_queue->isEmpty()) {
+        m_bell.Cancel();
+    }
+    else {
+        m_bell.Wait(seq);
+    }
+}
+
+// Same as LazyScheduler::AddGraph, restricted to the records owned by this 
+// partition. Chain lengths are only reset for the local records of actions 
+// this partition itself decided to substantiate, so a chain may be cut a 
+// little later than in the single-threaded scheduler.
+void
+SchedulerPartition::AddGraph(Action *action) {
+    assert(action->sched_seq > m_last_seq);
+    m_last_seq = action->sched_seq;
+    
+    int num_reads = action->readset.size();
+    int num_writes = action->writeset.size();
+    int* count_ptrs[num_reads+num_writes];
+    int num_local = 0;
+    
+    uint32_t force_materialize = action->materialize;
+    for (int i = 0; i < num_reads; ++i) {
+        CompositeKey record = action->readset[i].record;
+        if (PartitionOf(record, m_num_partitions) != m_partition_id) {
+            continue;
+        }
+        Heuristic *dep_info = m_tables[record.m_table]->GetPtr(record.m_key);
+        action->readset[i].m_dep = dep_info->Packed();
+        count_ptrs[num_local++] = &(dep_info->chain_length);
+        if (m_reclaim) {
+            try_cut(&action->readset[i], CUT_DEPTH);
+        }
+        
+        dep_info->Update(action, i, false);
+        if (m_reclaim) {
+            action_ref(action);
+        }
+        dep_info->chain_length += 1;
+        force_materialize |= (uint32_t)(dep_info->chain_length >= m_max_chain);
+    }
+    
+    for (int i = 0; i < num_writes; ++i) {
+        CompositeKey record = action->writeset[i].record;
+        if (PartitionOf(record, m_num_partitions) != m_partition_id) {
+            continue;
+        }
+        Heuristic *dep_info = m_tables[record.m_table]->GetPtr(record.m_key);
+        action->writeset[i].m_dep = dep_info->Packed();
+        count_ptrs[num_local++] = &(dep_info->chain_length);
+        if (m_reclaim) {
+            try_cut(&action->writeset[i], CUT_DEPTH);
+        }
+        
+        dep_info->Update(action, i, true);
+        if (m_reclaim) {
+            action_ref(action);
+        }
+        dep_info->chain_length += 1;
+        force_materialize |= (uint32_t)(dep_info->chain_length >= m_max_chain);
+    }
+    
+    if (force_materialize) {
+        for (int i = 0; i < num_local; ++i) {
+            *(count_ptrs[i]) = 0;
+        }
+        xchgq(&action->sched_force, 1);
+    }
+    
+    // The last partition to finish owns the action's hand off, and wakes the
+    // txns that found it half added. 
+    if (fetch_and_decrement(&action->sched_pending) == 0) {
+        LazyWorker::Wake(action);
+        if (action->sched_force) {
+            action_ref(action);
+            m_ready_queue->EnqueueBlocking((uint64_t)action);
+        }
+    }
+}
+
+// Pick the worker to substantiate an action whose records have the given 
+// Heuristic entries. 
+int
+LazyScheduler::ChooseWorker(Heuristic **deps, int num_deps) {
+    switch (m_routing) {
+    case ROUND_ROBIN:
+        return m_last_used % m_num_workers;
+    case LOCALITY: {
+        
+        // Go with the worker that owns most of the action's chains. 
+        int best = -1, best_votes = 0;
+        for (int i = 0; i < num_deps; ++i) {
+            int owner = deps[i]->owner;
+            if (owner == -1 || owner == best) {
+                continue;
+            }
+            int votes = 0;
+            for (int j = i; j < num_deps; ++j) {
+                votes += (int)(deps[j]->owner == owner);
+            }
+            if (votes > best_votes) {
+                best = owner;
+                best_votes = votes;
+            }
+        }
+        if (best != -1) {
+            return best;
+        }
+        return LeastLoaded();
+    }
+    case LEAST_LOADED:
+        return LeastLoaded();
+    default:
+        assert(false);
+    }
+    return 0;
+}
+
+// The worker with the fewest actions in its input queue. Ties go round robin.
+int
+LazyScheduler::LeastLoaded() {
+    int start = m_last_used % m_num_workers;
+    int best = start;
+    uint64_t best_size = 
+        m_worker_queues[start]->Size() + m_overflow[start].size();
+    for (int i = 1; i < m_num_workers && best_size > 0; ++i) {
+        int index = (start + i) % m_num_workers;
+        uint64_t size = 
+            m_worker_queues[index]->Size() + m_overflow[index].size();
+        if (size < best_size) {
+            best = index;
+            best_size = size;
+        }
+    }
+    return best;
+}
+
+// Pick up the controller's latest chain length threshold.
+void
+LazyScheduler::PollController() {
+    if (m_controller == NULL) {
+        return;
+    }
+    int threshold = m_controller->Poll();
+    if (threshold != m_max_chain) {
+        m_max_chain = threshold;
+        for (int i = 0; i < m_num_partitions && m_partitions != NULL; ++i) {
+            m_partitions[i]->SetMaxChain(threshold);
+        }
+    }
+}
+
 uint64_t
 LazyScheduler::NumStickified() {
     return m_num_stickified;
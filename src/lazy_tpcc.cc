@@ -8,9 +8,6 @@ NewOrderTxn::NewOrderTxn(uint64_t w_id, uint64_t d_id, uint64_t c_id,
                          uint32_t *orderQuantities) {
     uint32_t keys[10];
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
 
     uint64_t table_id;
 
@@ -275,9 +272,6 @@ PaymentTxn::PaymentTxn(uint32_t w_id, uint32_t c_w_id, float h_amount,
     uint64_t customer_key = TPCCKeyGen::create_customer_key(keys);
 
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = CUSTOMER;
     dep_info.record.m_key = customer_key;
     writeset.push_back(dep_info);
@@ -290,9 +284,6 @@ bool
 PaymentTxn::NowPhase() {
     /*
       struct DependencyInfo dep_info;
-      dep_info.dependency = NULL;
-      dep_info.is_write = false;
-      dep_info.index = -1;
     
       bool commit = true;
     
@@ -407,9 +398,6 @@ StockLevelTxn0::NowPhase() {
 void
 StockLevelTxn0::LaterPhase() {
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = OPEN_ORDER;
 
     uint32_t keys[3];
@@ -444,9 +432,6 @@ StockLevelTxn1::NowPhase() {
 void
 StockLevelTxn1::LaterPhase() {
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = STOCK;
 
     uint32_t stock_keys[2];
@@ -511,9 +496,6 @@ OrderStatusTxn0::OrderStatusTxn0(uint32_t w_id, uint32_t d_id, uint32_t c_id,
     assert(c_id < s_customers_per_dist);
 
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = OPEN_ORDER_INDEX;    
     
     m_warehouse_id = w_id;
@@ -542,9 +524,6 @@ OrderStatusTxn0::NowPhase() {
 void
 OrderStatusTxn0::LaterPhase() {
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = OPEN_ORDER;
 
     assert(readset[0].record.m_table == OPEN_ORDER_INDEX);
@@ -635,9 +614,6 @@ DeliveryTxn0::NowPhase() {
 void
 DeliveryTxn0::LaterPhase() {
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = OPEN_ORDER;
 
     uint32_t keys[4];
@@ -676,9 +652,6 @@ DeliveryTxn1::NowPhase() {
 void
 DeliveryTxn1::LaterPhase() {
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = CUSTOMER;
 
     uint32_t keys[4];
@@ -737,9 +710,6 @@ DeliveryTxn1::LaterPhase() {
 bool
 DeliveryTxn1::IsLinked(Action **action) {
     struct DependencyInfo dep_info;
-    dep_info.dependency = NULL;
-    dep_info.is_write = false;
-    dep_info.index = -1;
     dep_info.record.m_table = CUSTOMER;
 
     uint32_t num_orders = writeset.size();
@@ -12,291 +12,676 @@ LazyWorker::LazyWorker(SimpleQueue *input_queue, SimpleQueue *feedback_queue,
     m_output_queue = output_queue;
     m_feedback_queue = feedback_queue;
     m_cpu_number = (uint64_t)cpu;
-    InitActionNodes();
+    m_nodes = new SlabAllocator<ActionNode>(cpu);
     
-    m_queue_head = NULL;
-    m_queue_tail = NULL;
     m_num_elems = 0;
+    m_inbox = 0;
+    m_blocker = NULL;
+    m_stealable = new WorkStealingDeque(1<<12);
+    m_peers = NULL;
+    m_num_peers = 0;
+    m_id = 0;
+    m_steal = false;
+    m_num_steals = 0;
+    m_help = NULL;
+    m_parallel_width = 1;
+    m_num_helped = 0;
+    m_sticky_log = NULL;
+    m_idle_budget = 0;
+    m_budget_left = 0;
+    m_num_background = 0;
     m_num_done = 0;
+    m_num_cas_failures = 0;
+    m_max_depth = 0;
+    m_stack.reserve(1<<10);
+    m_blind_stack.reserve(1<<10);
+    m_latency_target = 0;
+    m_idle_cycles = 0;
+    m_num_materialized = 0;
+    m_num_slow = 0;
+    m_reclaim = false;
+    m_input_queue->SetConsumer(&m_bell);
+    m_output_queue->SetProducer(&m_bell);
 }
 
+// Park node on the action that blocked the last failed substantiation. 
 void
-LazyWorker::InitActionNodes() {
-    size_t num_nodes = 1<<24;
-    size_t size = sizeof(ActionNode)*num_nodes;
-    m_free_list = (ActionNode*)malloc(size);
-    memset(m_free_list, 0, size);
-
-    for (size_t i = 0; i < num_nodes-1; ++i) {
-        m_free_list[i].next = &m_free_list[i+1];
+LazyWorker::Park(ActionNode *node) {
+    Action *blocker = m_blocker;
+    assert(blocker != NULL);
+    uint64_t head;
+    do {
+        head = blocker->waiters;
+        node->next = (ActionNode*)head;
+    } while (!cmp_and_swap(&blocker->waiters, head, (uint64_t)node));
+    
+    // Whoever took the blocker out of PROCESSING, or the last partition to 
+    // add it to the graph, may have checked its waiters before we got there, 
+    // in which case it's up to us. A blocker partitions are still adding 
+    // will be woken by the last of them. 
+    if (blocker->state != PROCESSING && blocker->sched_pending == 0) {
+        Wake(blocker);
     }
-    m_free_list[num_nodes-1].next = NULL;
 }
 
+// Hand a parked node back to this worker. Called by any worker. 
 void
-LazyWorker::Enqueue(ActionNode *txn) {
-    if (m_queue_head == NULL) {
-        assert(m_queue_tail == NULL);
-        m_queue_head = txn;
-        m_queue_tail = txn;
-        txn->prev = NULL;
-        txn->next = NULL;
+LazyWorker::Deliver(ActionNode *node) {
+    uint64_t head;
+    do {
+        head = m_inbox;
+        node->next = (ActionNode*)head;
+    } while (!cmp_and_swap(&m_inbox, head, (uint64_t)node));
+    m_bell.Ring();
+}
+
+void
+LazyWorker::Wake(Action *txn) {
+    if (txn->waiters == 0) {
+        return;
     }
-    else {
-        m_queue_tail->next = txn;
-        txn->next = NULL;
-        txn->prev = m_queue_tail;
-        m_queue_tail = txn;
+    ActionNode *iter = (ActionNode*)xchgq(&txn->waiters, 0);
+    while (iter != NULL) {
+        ActionNode *next = iter->next;
+        iter->owner->Deliver(iter);
+        iter = next;
     }
-    m_num_elems += 1;
-    assert((m_queue_head == NULL && m_queue_tail == NULL) ||
-           (m_queue_head != NULL && m_queue_tail != NULL));
 }
 
+// Try a parked txn again now that whatever blocked it is done. 
 void
-LazyWorker::RemoveQueue(ActionNode *txn) {
-    ActionNode *prev = txn->prev;
-    ActionNode *next = txn->next;
-
-    if (m_queue_head == txn) {
-        assert(txn->prev == NULL);
-        m_queue_head = txn->next;
+LazyWorker::Retry(ActionNode *node) {
+    Action *txn = node->action;
+    if (ProcessFunction(txn)) {
+        Completed(txn);
+        m_num_elems -= 1;
+        ReturnActionNode(node);
     }
     else {
-        prev->next = next;
+        Park(node);
     }
-    
-    if (m_queue_tail == txn) {
-        assert(txn->next == NULL);
-        m_queue_tail = txn->prev;
+}
+
+// Substantiate txn along with every txn it depends on. Returns false if some 
+// dependency is being substantiated by another worker, in which case txn 
+// stays sticky and has to be retried later. 
+bool
+LazyWorker::ProcessFunction(Action *txn) {
+    assert(txn != NULL);
+    m_blocker = NULL;
+    if (txn->state == SUBSTANTIATED) {
+        return true;
     }
-    else {
-        next->prev = prev;
+    if (txn->is_blind) {
+        return ProcessBlind(txn);
+    }
+    if (!Claim(txn)) {
+        return false;
+    }
+    if (m_parallel_width > 1 && txn->materialize) {
+        Fork(txn);
+    }
+    return Substantiate(txn);
+}
+
+// Publish the chains txn depends on, up to m_parallel_width of them, and 
+// substantiate them newest first while idle peers take the oldest. Chains 
+// that share txns are kept apart by Claim, and anything left over is picked
+// up by txn's own walk. 
+//
+// txn is claimed, so its edges and the references they hold stay put. A 
+// read only needs its last writer, so reads that depend on another reader 
+// are left to the walk. 
+void
+LazyWorker::Fork(Action *txn) {
+    assert(txn->state == PROCESSING && m_stack.empty());
+    uint32_t num_reads = txn->readset.size();
+    uint32_t num_deps = num_reads + txn->writeset.size();
+    int num_published = 0;
+    for (uint32_t i = 0; 
+         i < num_deps && num_published < m_parallel_width; ++i) {
+        struct DependencyInfo *info = i < num_reads? 
+            &txn->readset[i] : &txn->writeset[i - num_reads];
+        Action *prev = info->Dependency();
+        if (prev == NULL || prev->state != STICKY || 
+            (i < num_reads && !info->IsWrite())) {
+            continue;
+        }
+        action_ref(prev);
+        if (!m_help->Push((uint64_t)prev)) {
+            action_release(prev);
+            break;
+        }
+        num_published += 1;
+    }
+    if (num_published > 1) {
+        for (int i = 1; i < m_num_peers; ++i) {
+            m_peers[(m_id + i) % m_num_peers]->m_bell.Ring();
+        }
     }
     
-    m_num_elems -= 1;
-    assert(m_num_elems >= 0);
-    assert((m_queue_head == NULL && m_queue_tail == NULL) ||
-           (m_queue_head != NULL && m_queue_tail != NULL));
+    Action *prev;
+    while (m_help->Pop((uint64_t*)&prev)) {
+        Help(prev);
+    }
+
+    // A chain we couldn't help with is no reason for txn to park, the walk
+    // finds out what it actually waits on. 
+    m_blocker = NULL;
 }
 
+// Substantiate a predecessor published by Fork, unless somebody got to it 
+// first, and drop the reference that came with it. 
+void
+LazyWorker::Help(Action *txn) {
+    if (txn->state == STICKY) {
+        if (txn->is_blind) {
+            ProcessBlind(txn);
+        }
+        else if (Claim(txn)) {
+            Substantiate(txn);
+        }
+    }
+    action_release(txn);
+}
 
+// Substantiate the oldest sticky txn on the scheduler's log, ahead of any 
+// materialized txn that needs it. Entries whose txns were substantiated since
+// they were logged are dropped on the way, without counting against the 
+// budget. 
+void
+LazyWorker::Background() {
+    Action *txn;
+    while (m_sticky_log->Steal((uint64_t*)&txn)) {
+        if (txn->state == STICKY) {
+            m_budget_left -= 1;
+            m_num_background += 1;
+            Help(txn);
+            return;
+        }
+        action_release(txn);
+    }
+}
 
+// Take a published predecessor off some other worker. Returns false if there
+// was nothing to take. 
 bool
-LazyWorker::ProcessFunction(Action *txn) {
-    assert(txn != NULL);
-    if (txn->state != SUBSTANTIATED) {
-        if (txn->is_blind) {
-            return ProcessBlind(txn);
+LazyWorker::StealHelp() {
+    Action *txn;
+    for (int i = 1; i < m_num_peers; ++i) {
+        LazyWorker *victim = m_peers[(m_id + i) % m_num_peers];
+        if (victim->m_help != NULL && 
+            victim->m_help->Steal((uint64_t*)&txn)) {
+            m_num_helped += 1;
+            Help(txn);
+            return true;
         }
-        if (cmp_and_swap(&txn->state, STICKY, PROCESSING)) {
+    }
+    return false;
+}
 
-            if (ProcessTxn(txn)) {
-                clock_gettime(CLOCK_REALTIME, &txn->end_time);
-                assert(txn->state == SUBSTANTIATED);
-                return true;
+// Take txn from STICKY to PROCESSING. A partitioned scheduler publishes txn
+// as the last txn on a record as soon as that record's partition is done with
+// it, so txn can be reached before the other partitions have filled in the 
+// rest of its dependencies. It can't be claimed until they have, a txn that 
+// fails on that parks on it until the last partition wakes it. 
+bool
+LazyWorker::Claim(Action *txn) {
+    if (txn->sched_pending == 0 && 
+        cmp_and_swap(&txn->state, STICKY, PROCESSING)) {
+        return true;
+    }
+    m_num_cas_failures += 1;
+    if (m_blocker == NULL) {
+        m_blocker = txn;
+    }
+    return false;
+}
+
+void
+LazyWorker::PushFrame(Action *txn) {
+    assert(txn->state == PROCESSING);
+    SubstFrame frame;
+    frame.txn = txn;
+    frame.prev = NULL;
+    frame.index = -1;
+    frame.is_write = false;
+    frame.on_write = false;
+    frame.ok = true;
+    frame.next_dep = 0;
+    m_stack.push_back(frame);
+    if (m_stack.size() > m_max_depth) {
+        m_max_depth = m_stack.size();
+    }
+}
+
+// Move the frame's walk along to the next txn that has to be substantiated 
+// before the frame's txn can run. Returns NULL once all of them are done. 
+//
+// A read only needs the last writer of the record, so its walk skips over 
+// earlier readers. A write has to wait for those readers as well, so its walk
+// returns every txn on the chain up to and including the last writer. 
+Action*
+LazyWorker::NextDependency(SubstFrame *frame) {
+    Action *txn = frame->txn;
+    uint32_t num_reads = txn->readset.size();
+    uint32_t num_deps = num_reads + txn->writeset.size();
+    
+    while (true) {
+        Action *prev = frame->prev;
+        if (prev != NULL) {
+            if (frame->on_write) {
+                return prev;
+            }
+            else if (prev->state == SUBSTANTIATED) {
+                frame->prev = NULL;
+            }
+            else if (frame->is_write) {
+                return prev;
             }
             else {
-                xchgq(&txn->state, STICKY);        
-                return false;
+                ChainResult(frame, true);
             }
+            continue;
         }
-        else {	// cmp_and_swap failed
-            return false;
+
+        // Start on the next entry's chain.
+        if (frame->next_dep == num_deps) {
+            return NULL;
         }
-    }
-    else {	// txn->state == SUBSTANTIATED
-        return true;
+        struct DependencyInfo *info = frame->next_dep < num_reads? 
+            &txn->readset[frame->next_dep] :
+            &txn->writeset[frame->next_dep - num_reads];
+        frame->on_write = frame->next_dep >= num_reads;
+        uint64_t dep = info->m_dep;
+        frame->is_write = PackedDep::IsWrite(dep);
+        frame->index = PackedDep::Index(dep);
+        frame->prev = PackedDep::Txn(dep);
+        frame->next_dep += 1;
     }
 }
 
+// The frame's current txn, frame->prev, has been dealt with. done is false if
+// it couldn't be substantiated, which gives up on the rest of its chain. 
+void
+LazyWorker::ChainResult(SubstFrame *frame, bool done) {
+    Action *prev = frame->prev;
+    if (!done) {
+        frame->ok = false;
+        frame->prev = NULL;
+    }
+    else if (frame->is_write) {
+        frame->prev = NULL;
+    }
+    else {
+        uint64_t dep = prev->readset[frame->index].m_dep;
+        frame->is_write = PackedDep::IsWrite(dep);
+        frame->index = PackedDep::Index(dep);
+        frame->prev = PackedDep::Txn(dep);
+    }
+}
 
+// Run txn if all its dependencies were substantiated, otherwise put it back.
 bool
-LazyWorker::processWrite(struct DependencyInfo *info) {
+LazyWorker::FinishTxn(Action *txn, bool ok) {
+    assert(txn->state == PROCESSING);
+    if (!ok) {
+        xchgq(&txn->state, STICKY);
+        Wake(txn);
+        return false;
+    }
 
-                         //Action *action, int writeIndex) {
-    
-    // Get the record and txn this action is dependent on. 
-    Action* prev = info->dependency;
-    bool is_write = info->is_write;
-    int index = info->index;
+    txn->LaterPhase();
+    clock_gettime(CLOCK_REALTIME, &txn->end_time);
+    xchgq(&txn->state, SUBSTANTIATED);
+    Wake(txn);
+    CutEdges(txn);
+    Action *next_link;
+    if (txn->IsLinked(&next_link)) {
+        assert(next_link != NULL);
+        m_feedback_queue->Enqueue((uint64_t)next_link);
+        if (m_reclaim) {
+            action_release(txn);
+        }
+    }
+    else {
+        m_num_done += 1;
+        Output(txn);
+    }
+    return true;
+}
 
-    while (prev != NULL) {
-        
-        // We only care if this txn has not been substantiated
-        if (!ProcessFunction(prev)) {
-            return false;
+// Depth-first walk of the dependency graph from txn, which the caller has 
+// already claimed. Each txn on the stack is claimed and finished only after 
+// everything it depends on, which is the order the recursive walk would use. 
+bool
+LazyWorker::Substantiate(Action *txn) {
+    assert(m_stack.empty());
+    PushFrame(txn);
+    while (true) {
+        SubstFrame *frame = &m_stack.back();
+        Action *prev = NextDependency(frame);
+        if (prev != NULL) {
+            if (prev->state == SUBSTANTIATED) {
+                ChainResult(frame, true);
+            }
+            else if (prev->is_blind) {
+                ChainResult(frame, ProcessBlind(prev));
+            }
+            else if (!Claim(prev)) {
+                ChainResult(frame, false);
+            }
+            else {
+                PushFrame(prev);
+            }
+            continue;
         }
         
-        if (is_write) {
-            return true;
-        }        
-        int cur_index = index;
-        is_write = prev->readset[cur_index].is_write;
-        index = prev->readset[cur_index].index;
-        prev = prev->readset[cur_index].dependency;        
+        bool done = FinishTxn(frame->txn, frame->ok);
+        m_stack.pop_back();
+        if (m_stack.empty()) {
+            return done;
+        }
+        ChainResult(&m_stack.back(), done);
     }
-    return true;
 }
 
+// Drop the edges of a substantiated txn that walks no longer need. Its write
+// set is only ever walked by the txn itself, but successors walk through its
+// read set to reach earlier readers of the same record. Edges only hold
+// references when txns are reclaimed, otherwise they're left alone.
+void
+LazyWorker::CutEdges(Action *txn) {
+    assert(txn->state == SUBSTANTIATED);
+    if (!m_reclaim) {
+        return;
+    }
+    for (size_t i = 0; i < txn->readset.size(); ++i) {
+        try_cut(&txn->readset[i], CUT_DEPTH);
+    }
+    for (size_t i = 0; i < txn->writeset.size(); ++i) {
+        Action *prev = txn->writeset[i].Dependency();
+        if (prev != NULL) {
+            cut_edge(&txn->writeset[i], prev);
+        }
+    }
+}
+
+// Hand a substantiated txn to the client. 
+void
+LazyWorker::Output(Action *txn) {
+    if (!m_output_queue->Enqueue((uint64_t)txn) && m_reclaim) {
+        action_release(txn);
+    }
+}
+
+// Substantiate the unmaterialized blind writes that action's blind write 
+// overwrites, and transitively the ones they overwrite. A blind write doesn't
+// need its predecessors' effects, so they only have to be marked done. 
 bool
 LazyWorker::ProcessBlindInner(Action *action) {
-    if (action->materialize == false) {
-        xchgq(&action->state, SUBSTANTIATED);
-        for (size_t i = 0; i < action->writeset.size(); ++i) {
-            if (action->writeset[i].dependency != NULL && 
-                action->writeset[i].dependency->state != SUBSTANTIATED) {
-                ProcessBlindInner(action->writeset[i].dependency);
+    if (action->materialize == true || action->sched_pending != 0 ||
+        !cmp_and_swap(&action->state, STICKY, SUBSTANTIATED)) {
+        return true;
+    }
+    
+    assert(m_blind_stack.empty());
+    BlindFrame frame;
+    frame.txn = action;
+    frame.next_dep = 0;
+    m_blind_stack.push_back(frame);
+    while (!m_blind_stack.empty()) {
+        BlindFrame *top = &m_blind_stack.back();
+        Action *txn = top->txn;
+        if (top->next_dep < txn->writeset.size()) {
+            Action *prev = txn->writeset[top->next_dep].Dependency();
+            top->next_dep += 1;
+            if (prev != NULL && prev->state != SUBSTANTIATED && 
+                prev->materialize == false && prev->sched_pending == 0 &&
+                cmp_and_swap(&prev->state, STICKY, SUBSTANTIATED)) {
+                frame.txn = prev;
+                m_blind_stack.push_back(frame);
+                if (m_blind_stack.size() > m_max_depth) {
+                    m_max_depth = m_blind_stack.size();
+                }
             }
         }
-        m_output_queue->Enqueue((uint64_t)action);
+        else {
+            CutEdges(txn);
+            Output(txn);
+            m_blind_stack.pop_back();
+        }
     }
     return true;    
 }
 
 bool
 LazyWorker::ProcessBlind(Action *action) {
-    if (cmp_and_swap(&action->state, STICKY, PROCESSING)) {
+    if (action->sched_pending == 0 && 
+        cmp_and_swap(&action->state, STICKY, PROCESSING)) {
         action->LaterPhase();
-        Action *link;
-        xchgq(&action->state, SUBSTANTIATED);
-        m_output_queue->EnqueueBlocking((uint64_t)action);
         clock_gettime(CLOCK_REALTIME, &action->end_time);
+        xchgq(&action->state, SUBSTANTIATED);
+        Wake(action);
         for (size_t i = 0; i < action->writeset.size(); ++i) {
-            ProcessBlindInner(action->writeset[i].dependency);
+            Action *prev = action->writeset[i].Dependency();
+            if (prev != NULL) {
+                ProcessBlindInner(prev);
+            }
         }
+        CutEdges(action);
+        m_output_queue->EnqueueBlocking((uint64_t)action);
         return true;
     }
     else {
+        m_num_cas_failures += 1;
+        if (m_blocker == NULL) {
+            m_blocker = action;
+        }
         return false;
     }
 }
 
+// Park a txn that couldn't be substantiated yet. The scheduler's reference 
+// on it moves along with it. 
+void
+LazyWorker::Wait(Action *txn) {
+    if (!m_steal || !m_stealable->Push((uint64_t)txn)) {
+        Block(txn);
+    }
+}
+
+// Park a txn on the action that kept it from being substantiated. 
+void
+LazyWorker::Block(Action *txn) {
+    ActionNode *wait_node = GetActionNode();
+    wait_node->action = txn;
+    wait_node->owner = this;
+    m_num_elems += 1;
+    Park(wait_node);
+}
+
+// txn is substantiated, drop the reference this worker held on it. 
+void
+LazyWorker::Completed(Action *txn) {
+    assert(txn->state == SUBSTANTIATED);
+    if (m_latency_target != 0) {
+        RecordLatency(txn);
+    }
+    action_release(txn);
+}
+
+// Retry the pending txns whose blockers have finished since we last looked. 
+// With work stealing on, they go back on m_stealable instead, and only the 
+// newest is retried here, so the rest stay up for grabs by idle peers. A txn 
+// is only kept private while it's parked, when nobody could make progress on 
+// it anyway. Returns true if some txn was retried. 
 bool
-LazyWorker::processRead(Action *action, int readIndex) {
-    Action* prev = action->readset[readIndex].dependency;
-    int index = action->readset[readIndex].index;
-    bool is_write = action->readset[readIndex].is_write;
-    uint32_t order_id = 0;
-    
-    bool ret = false;
-    
-    while (prev != NULL) {
-        if (is_write) {
-            int state;
-            
-            if (prev->state == SUBSTANTIATED) {
-                // The dependency is already processed, nothing to do here
-                return true;
-            }
-            else {
-                return ProcessFunction(prev);
-            }
-        }
-        else {  
-            if (prev->state == SUBSTANTIATED) {
-                return true;
+LazyWorker::CheckWaits() {
+    bool retried = false;
+    if (m_inbox != 0) {
+        ActionNode *iter = (ActionNode*)xchgq(&m_inbox, 0);
+        while (iter != NULL) {
+            ActionNode *next = iter->next;
+            if (m_steal && m_stealable->Push((uint64_t)iter->action)) {
+                m_num_elems -= 1;
+                ReturnActionNode(iter);
             }
             else {
-                int cur_index = index;
-                is_write = prev->readset[cur_index].is_write;
-                index = prev->readset[cur_index].index;
-                prev = prev->readset[cur_index].dependency;
+                Retry(iter);
+                retried = true;
             }
+            iter = next;
         }
     }
-    return true;
-}
 
-// Returns two values: 1. The transitive closure of txns to process 
-// 						(proc_head, proc_tail)
-//
-// 					   2. The set of txns we need to wait for
-//						(wait_head, wait_tail)
-bool
-LazyWorker::ProcessTxn(Action *txn) {
-    assert(txn != NULL);
-    assert(txn->state == PROCESSING);
-    
-    uint32_t read_index = 0, write_index = 0;
-    bool ret = true;
-    uint32_t reads_done = 0, writes_done = 0;
-
-    for (size_t i = 0; i < txn->readset.size(); ++i) {
-        if (!processRead(txn, i)) {
-            ret = false;
+    Action *txn;
+    if (m_stealable->Pop((uint64_t*)&txn)) {
+        if (ProcessFunction(txn)) {
+            Completed(txn);
         }
-    }
-    for (size_t i = 0; i < txn->writeset.size(); ++i) {
-        if (!processWrite(&txn->writeset[i])) {
-            ret = false;
+        else {
+            Block(txn);
         }
+        retried = true;
     }
+    return retried;
+}
 
-    if (ret) {
-
-        txn->LaterPhase();
-        xchgq(&txn->state, SUBSTANTIATED);
-        Action *next_link;
-        if (txn->IsLinked(&next_link)) {
-            assert(next_link != NULL);
-            m_feedback_queue->Enqueue((uint64_t)next_link);
-        }
-        else {
-            m_num_done += 1;
-            m_output_queue->Enqueue((uint64_t)txn);
+// Take the oldest pending txn off some other worker. Returns false if there 
+// was nothing to take. 
+bool
+LazyWorker::Steal() {
+    Action *txn;
+    for (int i = 1; i < m_num_peers; ++i) {
+        LazyWorker *victim = m_peers[(m_id + i) % m_num_peers];
+        if (victim->m_stealable->Steal((uint64_t*)&txn)) {
+            m_num_steals += 1;
+            if (ProcessFunction(txn)) {
+                Completed(txn);
+            }
+            else {
+                Block(txn);
+            }
+            return true;
         }
     }
-    return ret;
+    return false;
 }
 
+// Count a materialized txn, and whether it missed the latency target. 
 void
-LazyWorker::CheckWaits() {
-    ActionNode *iter = m_queue_head;
-    while (iter != NULL) {
-        ActionNode *to_ret = iter;
-        iter = iter->next;
-        if (ProcessFunction(to_ret->action)) {
-            assert(to_ret->action->state == SUBSTANTIATED);
-            RemoveQueue(to_ret);
-            ReturnActionNode(to_ret);
-        }        
-    }
+LazyWorker::RecordLatency(Action *txn) {
+    uint64_t usecs = 1000000*(txn->end_time.tv_sec - txn->start_time.tv_sec) + 
+        (txn->end_time.tv_nsec - txn->start_time.tv_nsec)/1000;
+    m_num_materialized += 1;
+    m_num_slow += (uint64_t)(usecs > m_latency_target);
 }
 
 void
 LazyWorker::StartWorking() {
     Action *txn;
+    uint64_t idle_start = 0;
+    uint64_t spins = 0;
+    EpochManager::Register();
     while (true) {
-        if (m_num_elems < 1000 && m_input_queue->Dequeue((uint64_t*)&txn)) {
+        bool idle = false;
+        EpochManager::Enter();
+        if (m_num_elems + m_stealable->Size() < 1000 && 
+            m_input_queue->Dequeue((uint64_t*)&txn)) {
+            idle_start = 0;
+            m_budget_left = m_idle_budget;
             clock_gettime(CLOCK_REALTIME, &txn->start_time);
+            
+            // The scheduler's reference on txn moves to the wait list if it
+            // can't be substantiated yet.
             if (!ProcessFunction(txn)) {
-                ActionNode *wait_node = GetActionNode();
-                wait_node->action = txn;
-                wait_node->prev = NULL;
-                wait_node->next = NULL;
-                Enqueue(wait_node);
+                Wait(txn);
+            }
+            else {
+                Completed(txn);
             }
         }
         else {
-            CheckWaits();
+            if (CheckWaits()) {
+                idle_start = 0;
+            }
+            else if (m_steal && m_num_elems < 1000 && Steal()) {
+                idle_start = 0;
+            }
+            else if (m_help != NULL && StealHelp()) {
+                idle_start = 0;
+            }
+
+            // Background work doesn't count against idle time, the 
+            // threshold controller should see the same load as without it.
+            else if (m_budget_left > 0 && m_num_elems == 0 && 
+                     m_sticky_log->Size() != 0) {
+                Background();
+            }
+            
+            // Nothing to do, count the time as idle. 
+            else {
+                idle = true;
+                if (m_latency_target != 0 && m_num_elems == 0) {
+                    uint64_t now = rdtsc();
+                    if (idle_start != 0) {
+                        m_idle_cycles += now - idle_start;
+                    }
+                    idle_start = now;
+                }
+            }
+        }
+        EpochManager::Exit();
+        if (!idle) {
+            spins = 0;
         }
+        else if (Doorbell::Spin(&spins)) {
+            Sleep();
+
+            // Whatever woke us up resets idle_start, count the time we were 
+            // parked before it does. 
+            if (idle_start != 0) {
+                uint64_t now = rdtsc();
+                m_idle_cycles += now - idle_start;
+                idle_start = now;
+            }
+        }
+    }
+}
+
+// Is there anything for StartWorking to do?
+bool
+LazyWorker::HasWork() {
+    return m_inbox != 0 || m_stealable->Size() != 0 ||
+        (m_num_elems + m_stealable->Size() < 1000 && 
+         !m_input_queue->isEmpty());
+}
+
+// Sleep until the scheduler sends a txn or a parked txn is delivered back. 
+// Peers that could be stolen from don't wake us up. 
+void
+LazyWorker::Sleep() {
+    uint32_t seq = m_bell.Prepare();
+    if (HasWork()) {
+        m_bell.Cancel();
+    }
+    else {
+        m_bell.Wait(seq);
     }
 }
 
 ActionNode*
 LazyWorker::GetActionNode() {
-    ActionNode *ret = m_free_list;
-    m_free_list = ret->next;
+    ActionNode *ret = m_nodes->Get();
     ret->next = NULL;
     ret->prev = NULL;
     ret->action = NULL;
     return ret;
 }
 
-// Return a list of ActionNodes to the free-list
+// Return an ActionNode to the slab
 void
 LazyWorker::ReturnActionNode(ActionNode *node) {
-    node->next = m_free_list;
-    m_free_list = node;
+    m_nodes->Put(node);
 }
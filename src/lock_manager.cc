@@ -130,6 +130,30 @@ LockManager::RemoveTxn(struct TxnQueue *queue,
     //    assert(queue->tail == NULL && queue->head == NULL); // XXX: REMOVE ME
 }
 
+// txn was granted one of the locks it was waiting for. If that was the last 
+// one, it's ready to run. 
+void
+LockManager::Grant(EagerAction *txn) {
+    if (fetch_and_decrement(&txn->num_dependencies) == 0) {
+        Ready(txn);
+    }
+}
+
+void
+EagerLockManager::Ready(EagerAction *txn) {
+    if (txn->ready == NULL) {
+        return;
+    }
+    uint64_t head;
+    do {
+        head = *txn->ready;
+        txn->next = (EagerAction*)head;
+    } while (!cmp_and_swap(txn->ready, head, (uint64_t)txn));
+    if (txn->bell != NULL) {
+        txn->bell->Ring();
+    }
+}
+
 void
 LockManager::AdjustWrite(struct EagerRecordInfo *dep) {
     assert(dep->is_write);
@@ -137,13 +161,13 @@ LockManager::AdjustWrite(struct EagerRecordInfo *dep) {
     if (next != NULL) {
         if (next->is_write) {
             next->is_held = true;
-            fetch_and_decrement(&next->dependency->num_dependencies);
+            Grant(next->dependency);
         }
         else {
             for (struct EagerRecordInfo *iter = next;
                  iter != NULL && !iter->is_write; iter = iter->next) {
                 iter->is_held = true;
-                fetch_and_decrement(&iter->dependency->num_dependencies);
+                Grant(iter->dependency);
             }
         }
     }
@@ -155,7 +179,7 @@ LockManager::AdjustRead(struct EagerRecordInfo *dep) {
     struct EagerRecordInfo *next = dep->next;
     if (next != NULL && dep->prev == NULL && next->is_write) {
         next->is_held = true;
-        fetch_and_decrement(&next->dependency->num_dependencies);
+        Grant(next->dependency);
     }
 }
 
@@ -377,9 +401,14 @@ LockManager::AcquireRead(EagerAction *txn, struct EagerRecordInfo *dep) {
 }
 */
 
+// Returns true if txn got all its locks right away. Otherwise, whoever grants
+// it its last lock pushes it on txn->ready. 
 bool
 LockManager::Lock(EagerAction *txn) {
-    txn->num_dependencies = 0;
+
+    // Hold an extra dependency until all the requests are in, so that a lock
+    // granted in the meantime can't make the txn look ready. 
+    txn->num_dependencies = 1;
     txn->finished_execution = false;
     size_t read_index = 0;
     size_t write_index = 0;
@@ -418,5 +447,5 @@ LockManager::Lock(EagerAction *txn) {
            read_index == txn->readset.size());
 
     FinishAcquisitions(txn);
-    return (txn->num_dependencies == 0);
+    return (fetch_and_decrement(&txn->num_dependencies) == 0);
 }
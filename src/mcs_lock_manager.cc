@@ -0,0 +1,233 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <mcs_lock_manager.hh>
+
+using namespace cc_params;
+
+// A request's mcs_state: whether it's still waiting for the lock, and the
+// kind of request that queued up behind it, if it has told us.
+#define MCS_BLOCKED 		0x1
+#define MCS_SUCC_READER		0x2
+#define MCS_SUCC_WRITER		0x4
+#define MCS_SUCC_MASK 		(MCS_SUCC_READER | MCS_SUCC_WRITER)
+
+// Txns this thread granted a lock to, linked through next, that still need
+// to request the rest of their locks.
+static __thread EagerAction *t_granted = NULL;
+
+// Replace the bits of *state in mask with bits. Returns the old state.
+static inline uint64_t
+set_state(volatile uint64_t *state, uint64_t mask, uint64_t bits) {
+    uint64_t old;
+    do {
+        old = *state;
+    } while (!cmp_and_swap(state, old, (old & ~mask) | bits));
+    return old;
+}
+
+McsLockManager::McsLockManager(TableInit *params, int num_params) {
+    m_tables = do_tbl_init<McsLock>(params, num_params);
+    assert(m_tables != NULL);
+}
+
+struct EagerRecordInfo*
+McsLockManager::Granted(struct EagerRecordInfo *dep) {
+    uint64_t old = set_state(&dep->mcs_state, MCS_BLOCKED, 0);
+    assert((old & MCS_BLOCKED) != 0);
+
+    // A reader that queued up behind a waiting reader leaves it to the
+    // waiting reader to let it in.
+    if (dep->is_write || (old & MCS_SUCC_MASK) != MCS_SUCC_READER) {
+        return NULL;
+    }
+    while (dep->mcs_next == NULL) {
+        do_pause();
+    }
+    fetch_and_increment(&dep->mcs_lock->reader_count);
+    return dep->mcs_next;
+}
+
+void
+McsLockManager::Unblock(struct EagerRecordInfo *dep) {
+    while (dep != NULL) {
+        EagerAction *txn = dep->dependency;
+        dep = Granted(dep);
+        txn->next = t_granted;
+        t_granted = txn;
+    }
+}
+
+bool
+McsLockManager::Acquire(struct EagerRecordInfo *dep) {
+    McsLock *lock = dep->mcs_lock;
+    dep->mcs_next = NULL;
+    dep->mcs_state = MCS_BLOCKED;
+    struct EagerRecordInfo *pred =
+        (struct EagerRecordInfo*)xchgq(&lock->tail, (uint64_t)dep);
+
+    if (dep->is_write) {
+        if (pred != NULL) {
+            set_state(&pred->mcs_state, MCS_SUCC_MASK, MCS_SUCC_WRITER);
+            pred->mcs_next = dep;
+            return false;
+        }
+
+        // The queue was empty, but readers may still hold the lock. The last
+        // of them to leave grants it to next_writer.
+        xchgq(&lock->next_writer, (uint64_t)dep);
+        if (lock->reader_count == 0 &&
+            xchgq(&lock->next_writer, 0) == (uint64_t)dep) {
+            Granted(dep);
+            return true;
+        }
+        return false;
+    }
+
+    if (pred == NULL) {
+        fetch_and_increment(&lock->reader_count);
+    }
+    else if (pred->is_write ||
+             cmp_and_swap(&pred->mcs_state, MCS_BLOCKED,
+                          MCS_BLOCKED | MCS_SUCC_READER)) {
+        pred->mcs_next = dep;
+        return false;
+    }
+    else {
+        // pred is a reader that already holds the lock.
+        fetch_and_increment(&lock->reader_count);
+        pred->mcs_next = dep;
+    }
+    Unblock(Granted(dep));
+    return true;
+}
+
+void
+McsLockManager::Release(struct EagerRecordInfo *dep) {
+    McsLock *lock = dep->mcs_lock;
+    if (lock == NULL) {
+        return;
+    }
+    if (dep->mcs_next == NULL &&
+        cmp_and_swap(&lock->tail, (uint64_t)dep, 0)) {
+        if (dep->is_write) {
+            return;
+        }
+    }
+    else {
+        // Someone swapped themselves in behind us, wait for them to link up.
+        while (dep->mcs_next == NULL) {
+            do_pause();
+        }
+        struct EagerRecordInfo *next = dep->mcs_next;
+        if (dep->is_write) {
+            if (!next->is_write) {
+                fetch_and_increment(&lock->reader_count);
+            }
+            Unblock(next);
+            return;
+        }
+        if ((dep->mcs_state & MCS_SUCC_MASK) == MCS_SUCC_WRITER) {
+            lock->next_writer = (uint64_t)next;
+        }
+    }
+
+    // The last reader out lets the next writer in.
+    if (fetch_and_decrement(&lock->reader_count) == 0) {
+        uint64_t writer = lock->next_writer;
+        if (writer != 0 && lock->reader_count == 0 &&
+            cmp_and_swap(&lock->next_writer, writer, 0)) {
+            Unblock((struct EagerRecordInfo*)writer);
+        }
+    }
+}
+
+bool
+McsLockManager::Continue(EagerAction *txn) {
+    while (true) {
+        uint32_t read_index = txn->lock_read_index;
+        uint32_t write_index = txn->lock_write_index;
+        struct EagerRecordInfo *dep;
+
+        // Merge the sorted read and write sets. A record can only be queued 
+        // on once per txn, or the txn would wait on itself. A read of a 
+        // record the txn also writes is covered by the write lock, and a 
+        // record that shows up twice in the same set by the first request.
+        if (read_index < txn->readset.size() &&
+            (write_index == txn->writeset.size() ||
+             txn->readset[read_index] <= txn->writeset[write_index])) {
+            dep = &txn->readset[read_index];
+            txn->lock_read_index += 1;
+            if ((write_index < txn->writeset.size() && 
+                 *dep == txn->writeset[write_index]) ||
+                (read_index > 0 && *dep == txn->readset[read_index-1])) {
+                dep->mcs_lock = NULL;
+                continue;
+            }
+            dep->is_write = false;
+        }
+        else if (write_index < txn->writeset.size()) {
+            dep = &txn->writeset[write_index];
+            txn->lock_write_index += 1;
+            if (write_index > 0 && *dep == txn->writeset[write_index-1]) {
+                dep->mcs_lock = NULL;
+                continue;
+            }
+            dep->is_write = true;
+        }
+        else {
+            txn->num_dependencies = 0;
+            return true;
+        }
+
+        dep->dependency = txn;
+        dep->mcs_lock = m_tables[dep->record.m_table]->GetPtr(dep->record.m_key);
+        assert(dep->mcs_lock != NULL);
+
+        // Once the request is in, the txn belongs to whoever grants it.
+        if (!Acquire(dep)) {
+            return false;
+        }
+    }
+}
+
+void
+McsLockManager::RunGranted() {
+    while (t_granted != NULL) {
+        EagerAction *txn = t_granted;
+        t_granted = txn->next;
+        if (Continue(txn)) {
+            Ready(txn);
+        }
+    }
+}
+
+bool
+McsLockManager::Lock(EagerAction *txn) {
+    txn->num_dependencies = 1;
+    txn->finished_execution = false;
+    txn->lock_read_index = 0;
+    txn->lock_write_index = 0;
+    bool ret = Continue(txn);
+    RunGranted();
+    return ret;
+}
+
+void
+McsLockManager::Unlock(EagerAction *txn) {
+    for (size_t i = 0; i < txn->writeset.size(); ++i) {
+        Release(&txn->writeset[i]);
+    }
+    for (size_t i = 0; i < txn->readset.size(); ++i) {
+        Release(&txn->readset[i]);
+    }
+    txn->finished_execution = true;
+    RunGranted();
+}
+
+// A waiting request can't be taken back out of its queue. Nothing kills eager
+// txns at the moment.
+void
+McsLockManager::Kill(EagerAction*) {
+    assert(false);
+}
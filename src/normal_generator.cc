@@ -15,6 +15,7 @@ NormalGenerator::NormalGenerator(int read_size,
     m_num_records = num_records;
     m_freq = freq;
     m_std_dev = std_dev;
+    m_pool = new ObjectPool<SimpleAction>();
     
     //    m_num_actions = 10000000;
     //	m_action_set = new Action[m_num_actions];
@@ -42,7 +43,7 @@ Action* NormalGenerator::genNext() {
     // Make sure that we generate unique records in the read/write set. 
     std::set<int> done;
 
-    SimpleAction *ret = new SimpleAction();
+    SimpleAction *ret = m_pool->Get();
     //    ret->start_time = 0;
     //    ret->end_time = 0;
     //    ret->system_start_time = 0;
@@ -0,0 +1,125 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <partition_router.hh>
+#include <time.h>
+
+PartitionRouter::PartitionRouter(SubmitQueue *input_queue,
+                                 SimpleQueue **partition_queues,
+                                 SimpleQueue **done_queues, int num_partitions,
+                                 uint32_t window, int cpu)
+    : Runnable(cpu) {
+    assert(num_partitions > 0 && num_partitions <= 64 && window > 0);
+    m_input_queue = input_queue;
+    m_partition_queues = partition_queues;
+    m_done_queues = done_queues;
+    m_num_partitions = num_partitions;
+    m_next_partition = 0;
+    m_num_active = 0;
+    m_window = window;
+    m_num_multi = 0;
+
+    m_input_queue->SetConsumer(&m_bell);
+    for (int i = 0; i < num_partitions; ++i) {
+        m_partition_queues[i]->SetProducer(&m_bell);
+        m_done_queues[i]->SetConsumer(&m_bell);
+    }
+}
+
+void
+PartitionRouter::Route(EagerAction *txn) {
+    uint64_t mask = txn_partitions(txn, m_num_partitions);
+    if (mask == 0) {
+        m_partition_queues[m_next_partition]->EnqueueBlocking((uint64_t)txn);
+        if (++m_next_partition == m_num_partitions) {
+            m_next_partition = 0;
+        }
+        return;
+    }
+
+    // Partitions count down num_dependencies as they get to txn.
+    int num_partitions = __builtin_popcountll(mask);
+    if (num_partitions > 1) {
+        m_num_multi += 1;
+    }
+    txn->num_dependencies = num_partitions;
+    txn->partition_released = 0;
+    for (int i = 0; i < m_num_partitions; ++i) {
+        if (mask & (1ULL << i)) {
+            m_partition_queues[i]->EnqueueBlocking((uint64_t)txn);
+        }
+    }
+}
+
+// txn's partition is done with it. Its successor in a chain takes its place
+// in the window.
+void
+PartitionRouter::Finish(EagerAction *txn) {
+    EagerAction *link;
+    if (txn->IsLinked(&link)) {
+        Route(link);
+    }
+    else {
+        m_num_active -= 1;
+    }
+}
+
+bool
+PartitionRouter::HasWork() {
+    for (int i = 0; i < m_num_partitions; ++i) {
+        if (!m_done_queues[i]->isEmpty()) {
+            return true;
+        }
+    }
+    return m_num_active < m_window && !m_input_queue->isEmpty();
+}
+
+// Sleep until a worker hands back a txn or a client submits one.
+void
+PartitionRouter::Sleep() {
+    uint32_t seq = m_bell.Prepare();
+    if (HasWork()) {
+        m_bell.Cancel();
+    }
+    else {
+        m_bell.Wait(seq);
+    }
+}
+
+void
+PartitionRouter::StartWorking() {
+    EagerAction *txns[PARTITION_BATCH];
+    uint64_t spins = 0;
+    while (true) {
+        bool idle = true;
+
+        // Finished chains make room in the window.
+        for (int i = 0; i < m_num_partitions; ++i) {
+            uint32_t num = m_done_queues[i]->DequeueBatch((uint64_t*)txns,
+                                                          PARTITION_BATCH);
+            for (uint32_t j = 0; j < num; ++j) {
+                Finish(txns[j]);
+            }
+            idle = idle && (num == 0);
+        }
+
+        uint32_t room = m_window - m_num_active;
+        if (room > PARTITION_BATCH) {
+            room = PARTITION_BATCH;
+        }
+        uint32_t num = m_input_queue->DequeueBatch((uint64_t*)txns, room);
+        for (uint32_t i = 0; i < num; ++i) {
+            clock_gettime(CLOCK_REALTIME, &txns[i]->start_time);
+            m_num_active += 1;
+            Route(txns[i]);
+        }
+        idle = idle && (num == 0);
+
+        if (!idle) {
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            Sleep();
+        }
+    }
+}
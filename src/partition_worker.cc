@@ -0,0 +1,102 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <partition_worker.hh>
+#include <time.h>
+
+PartitionWorker::PartitionWorker(int partition, int num_partitions,
+                                 SimpleQueue *input_queue,
+                                 SimpleQueue *done_queue,
+                                 SimpleQueue *output_queue, Doorbell *bells,
+                                 int cpu)
+    : Runnable(cpu) {
+    assert(partition >= 0 && partition < num_partitions);
+    m_partition = partition;
+    m_num_partitions = num_partitions;
+    m_input_queue = input_queue;
+    m_done_queue = done_queue;
+    m_output_queue = output_queue;
+    m_num_done = 0;
+    m_bells = bells;
+    m_input_queue->SetConsumer(&m_bells[partition]);
+    m_done_queue->SetProducer(&m_bells[partition]);
+    m_output_queue->SetProducer(&m_bells[partition]);
+}
+
+// Hold our partition until whoever runs txn is done with it.
+void
+PartitionWorker::Wait(EagerAction *txn) {
+    Doorbell *bell = &m_bells[m_partition];
+    uint64_t spins = 0;
+    while (txn->partition_released == 0) {
+        if (Doorbell::Spin(&spins)) {
+            uint32_t seq = bell->Prepare();
+            if (txn->partition_released != 0) {
+                bell->Cancel();
+            }
+            else {
+                bell->Wait(seq);
+            }
+        }
+    }
+}
+
+void
+PartitionWorker::Release(EagerAction *txn, uint64_t partitions) {
+    xchgq(&txn->partition_released, 1);
+    for (int i = 0; i < m_num_partitions; ++i) {
+        if (i != m_partition && (partitions & (1ULL << i))) {
+            m_bells[i].Ring();
+        }
+    }
+}
+
+void
+PartitionWorker::Process(EagerAction *txn) {
+    uint64_t mine = 1ULL << m_partition;
+    uint64_t partitions = txn_partitions(txn, m_num_partitions);
+
+    // The router set num_dependencies to the number of partitions txn
+    // touches, the last of them to get to it runs it.
+    if ((partitions & ~mine) != 0 &&
+        fetch_and_decrement(&txn->num_dependencies) != 0) {
+        Wait(txn);
+        return;
+    }
+
+    EagerAction *link;
+    bool linked;
+    while (true) {
+        txn->Execute();
+        txn->PostExec();
+        if ((partitions & ~mine) != 0) {
+            Release(txn, partitions);
+        }
+        linked = txn->IsLinked(&link);
+        if (!linked) {
+            break;
+        }
+        partitions = txn_partitions(link, m_num_partitions);
+        if ((partitions & ~mine) != 0) {
+            break;
+        }
+        txn = link;
+    }
+
+    // The router routes the rest of the chain, or retires it.
+    if (!linked) {
+        m_num_done += 1;
+        clock_gettime(CLOCK_REALTIME, &txn->end_time);
+    }
+    m_done_queue->EnqueueBlocking((uint64_t)txn);
+    if (!linked) {
+        m_output_queue->EnqueueBlocking((uint64_t)txn);
+    }
+}
+
+void
+PartitionWorker::StartWorking() {
+    while (true) {
+        Process((EagerAction*)m_input_queue->DequeueBlocking());
+    }
+}
@@ -0,0 +1,65 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <partitioned_experiment.hh>
+
+PartitionedExperiment::PartitionedExperiment(ExperimentInfo *info)
+    : EagerExperiment(info) {
+}
+
+void
+PartitionedExperiment::StartWorkers() {
+    for (int i = 0; i < m_info->num_workers; ++i) {
+        m_partition_workers[i]->Run();
+    }
+    m_router->Run();
+}
+
+// One partition per worker. The router runs on cpu 0, the workers on the next
+// num_workers cpus.
+void
+PartitionedExperiment::RunTPCC() {
+    int num_partitions = m_info->num_workers;
+
+    // All txns go through the router, in the order the clients submit them.
+    SubmitQueue *input_queue = new SubmitQueue(m_info->num_clients,
+                                               LARGE_QUEUE);
+    SimpleQueue **partition_queues = InitQueues(num_partitions, SMALL_QUEUE);
+    SimpleQueue **done_queues = InitQueues(num_partitions, SMALL_QUEUE);
+    SimpleQueue **output_queues = InitQueues(num_partitions, LARGE_QUEUE);
+    Doorbell *bells = new Doorbell[num_partitions];
+
+    m_router = new PartitionRouter(input_queue, partition_queues, done_queues,
+                                   num_partitions, SMALL_QUEUE, 0);
+    m_partition_workers = new PartitionWorker*[num_partitions];
+    for (int i = 0; i < num_partitions; ++i) {
+        m_partition_workers[i] = new PartitionWorker(i, num_partitions,
+                                                     partition_queues[i],
+                                                     done_queues[i],
+                                                     output_queues[i], bells,
+                                                     i+1);
+    }
+
+    InitInputs(&input_queue, m_info->num_txns, 1, NewGenerator());
+    DoThroughputExperiment(output_queues, num_partitions,
+                           (uint32_t)m_info->num_txns);
+    std::cout << "Multi-partition: " << m_router->NumMultiPartition() << "\n";
+    WriteTPCCLatencies();
+}
+
+// ExperimentInfo only lets TPCC runs through, the other workloads have no
+// warehouses to partition on.
+void
+PartitionedExperiment::RunThroughput() {
+    assert(false);
+}
+
+void
+PartitionedExperiment::RunPeak() {
+    assert(false);
+}
+
+void
+PartitionedExperiment::RunBlind() {
+    assert(false);
+}
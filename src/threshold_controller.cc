@@ -0,0 +1,73 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+// 
+
+#include <threshold_controller.hh>
+#include <machine.h>
+
+// Length of a control window, 1ms. 
+#define CONTROL_WINDOW (FREQUENCY/1000)
+
+// Wait list length per worker past which we consider workers backed up. 
+#define WAIT_HIGH_WATER 500
+
+ThresholdController::ThresholdController(LazyWorker **workers, int num_workers,
+                                         int initial_threshold, 
+                                         uint64_t latency_target) {
+    assert(initial_threshold > 0);
+    assert(latency_target > 0);
+    m_workers = workers;
+    m_num_workers = num_workers;
+    m_threshold = initial_threshold;
+    m_min_threshold = 1;
+    m_max_threshold = 16*initial_threshold;
+    m_step = initial_threshold/4 > 0? initial_threshold/4 : 1;
+    m_window = CONTROL_WINDOW;
+    m_window_start = rdtsc();
+    
+    m_last_idle = 0;
+    m_last_materialized = 0;
+    m_last_slow = 0;
+    m_num_increases = 0;
+    m_num_decreases = 0;
+    
+    for (int i = 0; i < m_num_workers; ++i) {
+        m_workers[i]->SetLatencyTarget(latency_target);
+    }
+}
+
+void
+ThresholdController::Adjust(uint64_t elapsed) {
+    uint64_t idle = 0, materialized = 0, slow = 0, waiting = 0;
+    for (int i = 0; i < m_num_workers; ++i) {
+        idle += m_workers[i]->NumIdleCycles();
+        materialized += m_workers[i]->NumMaterialized();
+        slow += m_workers[i]->NumSlow();
+        waiting += m_workers[i]->NumWaiting();
+    }
+    
+    uint64_t window_idle = idle - m_last_idle;
+    uint64_t window_materialized = materialized - m_last_materialized;
+    uint64_t window_slow = slow - m_last_slow;
+    m_last_idle = idle;
+    m_last_materialized = materialized;
+    m_last_slow = slow;
+
+    // Latency over target for more than 1% of txns, or growing wait lists. 
+    if (100*window_slow > window_materialized || 
+        waiting > (uint64_t)(WAIT_HIGH_WATER*m_num_workers)) {
+        if (m_threshold > m_min_threshold) {
+            m_threshold = m_threshold/2 > m_min_threshold? 
+                m_threshold/2 : m_min_threshold;
+            m_num_decreases += 1;
+        }
+    }
+    
+    // Workers spent more than a tenth of the window idle. 
+    else if (10*window_idle > elapsed*m_num_workers) {
+        if (m_threshold < m_max_threshold) {
+            m_threshold = m_threshold+m_step < m_max_threshold? 
+                m_threshold+m_step : m_max_threshold;
+            m_num_increases += 1;
+        }
+    }
+}
@@ -16,6 +16,7 @@ UniformGenerator::UniformGenerator(int read_size,
     m_num_records = num_records;
     m_freq = freq;
     m_use_next = 0;
+    m_pool = new ObjectPool<SimpleAction>();
     //    m_num_actions = 10000000;
     //    m_action_set = new Action[m_num_actions];
     //    memset(m_action_set, 0, sizeof(Action)*m_num_actions);
@@ -57,7 +58,7 @@ Action* UniformGenerator::genNext() {
     uint64_t worker = m_use_next % 7;
     m_use_next += 1;
 
-    SimpleAction* ret = new SimpleAction();
+    SimpleAction* ret = m_pool->Get();
     for (int i = 0; i < m_write_set_size; ++i) {
         struct DependencyInfo to_add;
         to_add.record.m_table = 0;
@@ -0,0 +1,121 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+
+#include <vll_lock_manager.hh>
+#include <cstring>
+
+using namespace cc_params;
+
+// States of a txn in its VllSlot.
+#define VLL_RUNNING 		0x1
+#define VLL_BLOCKED 		0x2
+#define VLL_DONE 			0x3
+#define VLL_STATE_BITS 		2
+
+static inline uint64_t
+slot_word(uint64_t seq, uint64_t state) {
+    return (seq << VLL_STATE_BITS) | state;
+}
+
+VllLockManager::VllLockManager(TableInit *params, int num_params) {
+    m_tables = do_tbl_init<VllCounters>(params, num_params);
+    assert(m_tables != NULL);
+    m_latch = 0;
+    m_next_seq = 0;
+    m_head = 0;
+    m_slots = (VllSlot*)malloc(sizeof(VllSlot)*VLL_RING_SIZE);
+    assert(m_slots != NULL);
+    memset(m_slots, 0, sizeof(VllSlot)*VLL_RING_SIZE);
+}
+
+void
+VllLockManager::Advance() {
+    while (true) {
+        uint64_t head = m_head;
+        VllSlot *slot = &m_slots[head & (VLL_RING_SIZE-1)];
+        uint64_t word = slot->word;
+        if (word == slot_word(head, VLL_DONE)) {
+            cmp_and_swap(&m_head, head, head+1);
+        }
+        else {
+            // Everything ahead of a blocked txn is done, so it's safe to run.
+            if (word == slot_word(head, VLL_BLOCKED) &&
+                cmp_and_swap(&slot->word, word,
+                             slot_word(head, VLL_RUNNING))) {
+                EagerAction *txn = slot->txn;
+                txn->num_dependencies = 0;
+                Ready(txn);
+            }
+            return;
+        }
+    }
+}
+
+bool
+VllLockManager::Lock(EagerAction *txn) {
+    txn->finished_execution = false;
+    bool blocked = false;
+
+    lock(&m_latch);
+    uint64_t seq = m_next_seq++;
+    assert(seq - m_head < VLL_RING_SIZE);
+
+    // Counters only go down while we hold the latch, so a conflict we see
+    // might be gone already, but never one we miss.
+    for (size_t i = 0; i < txn->writeset.size(); ++i) {
+        VllCounters *counters = Counters(&txn->writeset[i]);
+        if (fetch_and_increment(&counters->cx) > 1 || counters->cs > 0) {
+            blocked = true;
+        }
+    }
+    for (size_t i = 0; i < txn->readset.size(); ++i) {
+        VllCounters *counters = Counters(&txn->readset[i]);
+        fetch_and_increment(&counters->cs);
+        if (counters->cx > 0) {
+            blocked = true;
+        }
+    }
+
+    txn->lock_seq = seq;
+    txn->num_dependencies = blocked ? 1 : 0;
+    VllSlot *slot = &m_slots[seq & (VLL_RING_SIZE-1)];
+    slot->txn = txn;
+    xchgq(&slot->word, slot_word(seq, blocked ? VLL_BLOCKED : VLL_RUNNING));
+    unlock(&m_latch);
+
+    if (!blocked) {
+        return true;
+    }
+
+    // If everything ahead of us finished before we were in the ring, nobody
+    // will hand us out.
+    if (m_head == seq &&
+        cmp_and_swap(&slot->word, slot_word(seq, VLL_BLOCKED),
+                     slot_word(seq, VLL_RUNNING))) {
+        txn->num_dependencies = 0;
+        return true;
+    }
+    return false;
+}
+
+void
+VllLockManager::Unlock(EagerAction *txn) {
+    for (size_t i = 0; i < txn->writeset.size(); ++i) {
+        fetch_and_decrement(&Counters(&txn->writeset[i])->cx);
+    }
+    for (size_t i = 0; i < txn->readset.size(); ++i) {
+        fetch_and_decrement(&Counters(&txn->readset[i])->cs);
+    }
+    txn->finished_execution = true;
+
+    uint64_t seq = txn->lock_seq;
+    xchgq(&m_slots[seq & (VLL_RING_SIZE-1)].word, slot_word(seq, VLL_DONE));
+    Advance();
+}
+
+// A blocked txn could be handed out concurrently. Nothing kills eager txns at
+// the moment.
+void
+VllLockManager::Kill(EagerAction*) {
+    assert(false);
+}
@@ -0,0 +1,133 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+// Compares the cost of the scheduler's per-record dependency table updates
+// with the packed Heuristic entries against the original padded layout. Each
+// simulated action reads a few records and writes a few others, exactly as
+// LazyScheduler::AddGraph does, over a OneDimTable of num_records entries.
+//
+// Build: make bench, which builds every test/*_bench.cc into build/.
+#include "lazy_scheduler.hh"
+#include "one_dim_table.hh"
+
+#include <cassert>
+#include <iostream>
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#define 	MILLION 	(1 << 20)
+#define 	NUM_ACTIONS	(1 << 12)
+
+using namespace std;
+
+// The Heuristic entry as it was laid out before it was packed.
+class LegacyHeuristic {
+public:
+    Action* last_txn;
+    int index;
+    bool is_write;
+    int chain_length;
+    int owner;
+
+    LegacyHeuristic() {
+        last_txn = NULL;
+        index = -1;
+        is_write = false;
+        chain_length = 0;
+        owner = -1;
+    }
+
+    inline Action* LastTxn() const { return last_txn; }
+    inline int Index() const { return index; }
+    inline bool IsWrite() const { return is_write; }
+
+    inline void
+    Update(Action *txn, int idx, bool write) {
+        last_txn = txn;
+        index = idx;
+        is_write = write;
+    }
+};
+
+uint64_t*
+init_keys(uint32_t num_keys, uint32_t num_records) {
+    uint64_t *keys = (uint64_t*)malloc(sizeof(uint64_t)*num_keys);
+    for (uint32_t i = 0; i < num_keys; ++i) {
+        keys[i] = (uint64_t)rand() % num_records;
+    }
+    return keys;
+}
+
+// Runs the AddGraph dependency table updates for every record in keys and
+// returns the number of cycles per record.
+template<class H>
+double
+run(Table<uint64_t, H> *tbl, Action *actions, uint64_t *keys,
+    uint32_t num_keys, uint32_t records_per_txn, int max_chain) {
+    DependencyInfo info;
+    uint64_t num_materialized = 0;
+    uint32_t num_reads = records_per_txn / 2;
+
+    uint64_t start = rdtsc();
+    for (uint32_t i = 0; i + records_per_txn <= num_keys; 
+         i += records_per_txn) {
+        Action *action = &actions[(i / records_per_txn) % NUM_ACTIONS];
+        H *deps[records_per_txn];
+        bool force_materialize = false;
+        for (uint32_t j = 0; j < records_per_txn; ++j) {
+            bool is_write = j >= num_reads;
+            int index = is_write? j - num_reads : j;
+            H *dep_info = tbl->GetPtr(keys[i+j]);
+            info.SetDependency(dep_info->LastTxn(), dep_info->Index(), 
+                               dep_info->IsWrite());
+            deps[j] = dep_info;
+            dep_info->Update(action, index, is_write);
+            dep_info->chain_length += 1;
+            force_materialize |= dep_info->chain_length >= max_chain;
+        }
+        if (force_materialize) {
+            for (uint32_t j = 0; j < records_per_txn; ++j) {
+                deps[j]->chain_length = 0;
+            }
+            num_materialized += 1;
+        }
+    }
+    uint64_t end = rdtsc();
+
+    // Keep the compiler from throwing the loop away.
+    if (info.Dependency() == NULL && num_materialized == 0) {
+        cout << "";
+    }
+    return (double)(end - start) / num_keys;
+}
+
+int
+main(int argc, char **argv) {
+    uint32_t num_records = argc > 1? atoi(argv[1]) : MILLION;
+    uint32_t num_keys = argc > 2? atoi(argv[2]) : 16*MILLION;
+    uint32_t records_per_txn = 10;
+    int max_chain = 50;
+
+    uint64_t *keys = init_keys(num_keys, num_records);
+    Action *actions = new Action[NUM_ACTIONS];
+    Table<uint64_t, LegacyHeuristic> *legacy =
+        new OneDimTable<LegacyHeuristic>(num_records);
+    Table<uint64_t, Heuristic> *packed = 
+        new OneDimTable<Heuristic>(num_records);
+
+    // Warm up both tables so neither run pays for first touch.
+    run(legacy, actions, keys, num_keys, records_per_txn, max_chain);
+    run(packed, actions, keys, num_keys, records_per_txn, max_chain);
+
+    double legacy_cycles =
+        run(legacy, actions, keys, num_keys, records_per_txn, max_chain);
+    double packed_cycles =
+        run(packed, actions, keys, num_keys, records_per_txn, max_chain);
+
+    cout << "Records: " << num_records << "\n";
+    cout << "Legacy entry: " << sizeof(LegacyHeuristic) << " bytes, "
+         << legacy_cycles << " cycles/record\n";
+    cout << "Packed entry: " << sizeof(Heuristic) << " bytes, "
+         << packed_cycles << " cycles/record\n";
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+// Measures what an idle consumer costs at low load, and how long it takes to
+// react to new work, for different Doorbell spin limits. A producer enqueues
+// one timestamp every GAP_USECS onto a SimpleQueue, the consumer polls it the
+// same way the lazy workers poll their input queues, parking once it has
+// spun for the limit. A limit of 0 is the old always-spin behaviour.
+//
+// Build: g++ -O2 -std=c++0x -DNDEBUG -Iinclude test/idle_bench.cc \
+//            src/doorbell.cc -lpthread
+#include "concurrent_queue.h"
+#include "doorbell.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define 	QUEUE_SIZE 	(1 << 10)
+#define 	NUM_ITEMS	2000
+#define 	GAP_USECS	200
+
+using namespace std;
+
+struct BenchState {
+    SimpleQueue 		*queue;
+    Doorbell 			bell;
+    vector<uint64_t> 	latencies;
+    double 				cpu_ms;
+};
+
+static double
+thread_cpu_ms() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec*1000.0 + now.tv_nsec/1000000.0;
+}
+
+static void*
+consumer(void *arg) {
+    BenchState *state = (BenchState*)arg;
+    double start = thread_cpu_ms();
+    uint64_t spins = 0;
+    uint64_t sent;
+    int received = 0;
+    while (received < NUM_ITEMS) {
+        if (state->queue->Dequeue(&sent)) {
+            state->latencies.push_back(rdtsc() - sent);
+            received += 1;
+            spins = 0;
+        }
+        else if (Doorbell::Spin(&spins)) {
+            uint32_t seq = state->bell.Prepare();
+            if (!state->queue->isEmpty()) {
+                state->bell.Cancel();
+            }
+            else {
+                state->bell.Wait(seq);
+            }
+        }
+    }
+    state->cpu_ms = thread_cpu_ms() - start;
+    return NULL;
+}
+
+static void
+run(uint64_t spin_limit) {
+    Doorbell::s_spin_limit = spin_limit;
+    BenchState state;
+    char *data = (char*)malloc(sizeof(uint64_t)*QUEUE_SIZE);
+    state.queue = new SimpleQueue(data, QUEUE_SIZE);
+    state.queue->SetConsumer(&state.bell);
+    state.latencies.reserve(NUM_ITEMS);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, consumer, &state);
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        usleep(GAP_USECS);
+        state.queue->EnqueueBlocking(rdtsc());
+    }
+    pthread_join(thread, NULL);
+
+    sort(state.latencies.begin(), state.latencies.end());
+    cout << "spin_limit " << spin_limit;
+    cout << " median_cycles " << state.latencies[NUM_ITEMS/2];
+    cout << " p99_cycles " << state.latencies[(NUM_ITEMS*99)/100];
+    cout << " consumer_cpu_ms " << state.cpu_ms;
+    cout << " parks " << state.bell.NumParks() << "\n";
+
+    delete state.queue;
+    free(data);
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t limits[] = { 0, 100000, 10000, 1000, 100 };
+    for (size_t i = 0; i < sizeof(limits)/sizeof(limits[0]); ++i) {
+        run(limits[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+// Cost per value of moving NUM_ITEMS values through a SimpleQueue, one at a 
+// time and in batches of different sizes. Checks that values come out in 
+// order.
+//
+// Then the same number of values through a SubmitQueue fed by up to 
+// MAX_PRODUCERS threads at once, checking that each producer's values come 
+// out in the order it put them in. Exits with 1 if any don't.
+//
+// Build: make bench
+#include "concurrent_queue.h"
+#include "submit_queue.hh"
+
+#include <iostream>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define 	QUEUE_SIZE 	(1 << 12)
+#define 	NUM_ITEMS	(1 << 22)
+#define 	MAX_BATCH	64
+#define 	MAX_PRODUCERS	64
+#define 	PRODUCER_SHIFT	40
+#define 	SPIN_LIMIT	1000
+
+using namespace std;
+
+// Fill the queue with QUEUE_SIZE values and drain it again until NUM_ITEMS 
+// have gone through, all on one thread, so the numbers are the cost of the 
+// queue operations themselves rather than of cross-core traffic. 
+static double
+run(uint32_t batch) {
+    char *data = (char*)malloc(sizeof(uint64_t)*QUEUE_SIZE);
+    SimpleQueue *queue = new SimpleQueue(data, QUEUE_SIZE);
+    uint64_t values[MAX_BATCH];
+    uint64_t next = 0, expected = 0;
+
+    uint64_t start = rdtsc();
+    while (expected < NUM_ITEMS) {
+        if (batch == 1) {
+            while (queue->Enqueue(next)) {
+                next += 1;
+            }
+            while (queue->Dequeue(&values[0])) {
+                assert(values[0] == expected);
+                expected += 1;
+            }
+            continue;
+        }
+        uint32_t num;
+        do {
+            for (uint32_t i = 0; i < batch; ++i) {
+                values[i] = next + i;
+            }
+            num = queue->EnqueueBatch(values, batch);
+            next += num;
+        } while (num == batch);
+        while ((num = queue->DequeueBatch(values, batch)) != 0) {
+            for (uint32_t i = 0; i < num; ++i) {
+                assert(values[i] == expected);
+                expected += 1;
+            }
+        }
+    }
+    uint64_t end = rdtsc();
+
+    delete queue;
+    free(data);
+    return (double)(end - start) / expected;
+}
+
+// Wait a little for the other side. There may be more producers than cpus, 
+// so give up the cpu if that takes too long. 
+static inline void
+backoff(uint64_t *spins) {
+    if (++(*spins) < SPIN_LIMIT) {
+        do_pause();
+    }
+    else {
+        *spins = 0;
+        sched_yield();
+    }
+}
+
+struct Producer {
+    SimpleQueue 		*ring;
+    uint64_t 			id;
+    uint64_t 			num_items;
+    volatile uint64_t 	*start;
+    pthread_t 			thread;
+};
+
+// Tag each value with the producer, so the consumer can tell the streams 
+// apart. 
+static void*
+produce(void *arg) {
+    Producer *me = (Producer*)arg;
+    uint64_t spins = 0;
+    while (*me->start == 0) {
+        backoff(&spins);
+    }
+    for (uint64_t i = 0; i < me->num_items; ++i) {
+        while (!me->ring->Enqueue((me->id << PRODUCER_SHIFT) | i)) {
+            backoff(&spins);
+        }
+    }
+    return NULL;
+}
+
+// Drain NUM_ITEMS values from num_producers threads submitting at once. 
+// Returns the consumer's throughput in millions of values a second, and adds
+// the values that came out of order to num_errors. 
+static double
+run_submit(int num_producers, uint64_t *num_errors) {
+    SubmitQueue *queue = new SubmitQueue(num_producers, QUEUE_SIZE);
+    Producer *producers = new Producer[num_producers];
+    uint64_t *next = new uint64_t[num_producers];
+    volatile uint64_t start = 0;
+    uint64_t total = 0;
+    for (int i = 0; i < num_producers; ++i) {
+        producers[i].ring = queue->Producer(i);
+        producers[i].id = i;
+        producers[i].num_items = NUM_ITEMS / num_producers;
+        producers[i].start = &start;
+        total += producers[i].num_items;
+        next[i] = 0;
+        pthread_create(&producers[i].thread, NULL, produce, &producers[i]);
+    }
+
+    timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    xchgq(&start, 1);
+    uint64_t values[MAX_BATCH];
+    uint64_t seen = 0, spins = 0;
+    while (seen < total) {
+        uint32_t num = queue->DequeueBatch(values, MAX_BATCH);
+        if (num == 0) {
+            backoff(&spins);
+        }
+        for (uint32_t i = 0; i < num; ++i) {
+            uint64_t id = values[i] >> PRODUCER_SHIFT;
+            uint64_t seq = values[i] & ((1ULL << PRODUCER_SHIFT) - 1);
+            if (seq != next[id]) {
+                *num_errors += 1;
+            }
+            next[id] = seq + 1;
+        }
+        seen += num;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    for (int i = 0; i < num_producers; ++i) {
+        pthread_join(producers[i].thread, NULL);
+    }
+    delete[] next;
+    delete[] producers;
+    double usecs = 1000000.0*(end_time.tv_sec - start_time.tv_sec) + 
+        (end_time.tv_nsec - start_time.tv_nsec)/1000.0;
+    return total / usecs;
+}
+
+int
+main(int argc, char **argv) {
+    uint32_t batches[] = { 1, 8, 32, MAX_BATCH };
+    for (size_t i = 0; i < sizeof(batches)/sizeof(batches[0]); ++i) {
+        cout << "batch " << batches[i];
+        cout << " cycles_per_item " << run(batches[i]) << "\n";
+    }
+
+    int producers[] = { 1, 8, 32, MAX_PRODUCERS };
+    uint64_t num_errors = 0;
+    for (size_t i = 0; i < sizeof(producers)/sizeof(producers[0]); ++i) {
+        cout << "producers " << producers[i];
+        cout << " mitems_per_sec " << run_submit(producers[i], &num_errors);
+        cout << endl;
+    }
+    cout << "out_of_order " << num_errors << "\n";
+    return num_errors == 0? 0 : 1;
+}
@@ -0,0 +1,101 @@
+// Author: Jose M. Faleiro (faleiro.jose.manuel@gmail.com)
+//
+// Compares the cost of building and freeing a txn whose read and write sets
+// are std::vectors, as they used to be, against the inline sets with Arena
+// overflow. Each txn gets num_reads reads and num_writes writes, the way the
+// generators fill them in, and is freed right away as in a streaming run.
+// Then has a second thread free the txns the first one builds, the way the
+// workers free a streaming client's txns, and reports whether the builder 
+// keeps taking chunks from malloc.
+//
+// Build: g++ -O2 -std=c++0x -DNDEBUG -Iinclude test/txn_alloc_bench.cc \
+//            src/arena.cc src/doorbell.cc -lpthread
+#include "action.h"
+#include "concurrent_queue.h"
+
+#include <iostream>
+#include <vector>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define 	NUM_TXNS	(1 << 20)
+#define 	QUEUE_SIZE	(1 << 10)
+
+using namespace std;
+
+class LegacyAction {
+public:
+    std::vector<struct DependencyInfo> readset;
+    std::vector<struct DependencyInfo> writeset;
+};
+
+template<class TxnType>
+static double
+run(int num_reads, int num_writes) {
+    struct DependencyInfo info;
+    uint64_t start = rdtsc();
+    for (int i = 0; i < NUM_TXNS; ++i) {
+        TxnType *txn = new TxnType();
+        for (int j = 0; j < num_reads; ++j) {
+            info.record.m_key = (uint64_t)(i + j);
+            txn->readset.push_back(info);
+        }
+        for (int j = 0; j < num_writes; ++j) {
+            info.record.m_key = (uint64_t)(i + j);
+            txn->writeset.push_back(info);
+        }
+        delete txn;
+    }
+    return (double)(rdtsc() - start) / NUM_TXNS;
+}
+
+static void*
+free_txns(void *arg) {
+    SimpleQueue *queue = (SimpleQueue*)arg;
+    for (int i = 0; i < NUM_TXNS; ++i) {
+        delete (Action*)queue->DequeueBlocking();
+    }
+    return NULL;
+}
+
+// Returns the number of chunks the building thread took from malloc.
+static uint64_t
+run_remote(int num_reads, int num_writes) {
+    char *data = (char*)malloc(sizeof(uint64_t)*QUEUE_SIZE);
+    SimpleQueue *queue = new SimpleQueue(data, QUEUE_SIZE);
+    pthread_t thread;
+    pthread_create(&thread, NULL, free_txns, queue);
+
+    struct DependencyInfo info;
+    uint64_t num_chunks = Arena::NumChunks();
+    for (int i = 0; i < NUM_TXNS; ++i) {
+        Action *txn = new Action();
+        for (int j = 0; j < num_reads; ++j) {
+            info.record.m_key = (uint64_t)(i + j);
+            txn->readset.push_back(info);
+        }
+        for (int j = 0; j < num_writes; ++j) {
+            info.record.m_key = (uint64_t)(i + j);
+            txn->writeset.push_back(info);
+        }
+        queue->EnqueueBlocking((uint64_t)txn);
+    }
+    pthread_join(thread, NULL);
+    return Arena::NumChunks() - num_chunks;
+}
+
+int
+main(int argc, char **argv) {
+    int sizes[] = { 2, 4, 10, 20 };
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+        int size = sizes[i];
+        cout << "reads " << size << " writes " << size;
+        cout << " vector_cycles " << run<LegacyAction>(size, size);
+        cout << " inline_cycles " << run<Action>(size, size) << "\n";
+    }
+    cout << "arena chunks " << Arena::NumChunks() << "\n";
+    cout << "remote free chunks " << run_remote(10, 10) << "\n";
+    return 0;
+}